@@ -1,5 +1,6 @@
 #!/bin/bash
 MPI_SOURCE="mpi_lcs.c"
+HYBRID_SOURCE="hybrid_lcs.c"
 SEQ_SOURCE="seq_lcs.c"
 BIN_DIR="bin"
 JOBS_DIR="jobs"
@@ -7,6 +8,7 @@ INPUTS_DIR="inputs"
 LOG_ROOT="logsmpi"
 SEQ_BIN="./$BIN_DIR/lcs_seq.bin"
 MPI_BIN="./$BIN_DIR/lcs_mpi.bin"
+HYBRID_BIN="./$BIN_DIR/lcs_hybrid.bin"
 USER="lgbl"
 
 # Configurações
@@ -26,12 +28,17 @@ if [ $? -ne 0 ]; then
     echo "Compilation failed. Exiting."
     exit 1
 fi
+mpicc -O3 -march=native -funroll-loops -flto -fopenmp $HYBRID_SOURCE -o $HYBRID_BIN -lm
+if [ $? -ne 0 ]; then
+    echo "Compilation failed. Exiting."
+    exit 1
+fi
 gcc -O3 -march=native -funroll-loops -flto -fopenmp $SEQ_SOURCE -o $SEQ_BIN
 if [ $? -ne 0 ]; then
     echo "Compilation failed. Exiting."
     exit 1
 fi
-#gcc -O3 -march=native -funroll-loops -flto -fopenmp seq_lcs_prof.c -o seqprof
+#gcc -O2 lcs_bench.c -o lcs_bench -lm
 
 if [ $? -ne 0 ]; then
     echo "Erro de compilação."
@@ -82,38 +89,57 @@ for size in "${input_sizes[@]}"; do
         fi
 
         time="00:30:00"
-        LOG_DIR="$LOG_ROOT/${size_a_k}k_${size_b_k}k/${tasks}"
-        mkdir -p "$LOG_DIR"
 
-        echo "  Tasks: $tasks, Nodes: $nodes, Memória: $mem"
-
-        for run in $(seq 1 "$num_runs"); do
-            LOG="$LOG_DIR/$run.log"
-            if [ -s "$LOG" ]; then
-                continue
-            fi
+        if [ "$tasks" -eq 1 ]; then
+            tasks_per_node=$tasks
+        else
+            per_node=$((($tasks + 1) / 2))
+            tasks_per_node=$per_node
+        fi
 
-            JOB_FILE="$JOBS_DIR/${size_a_k}k_${size_b_k}k_${tasks}t.sbatch"
+        # O híbrido usa os mesmos núcleos: um rank por nó com tasks_per_node threads
+        engines=(mpi)
+        if [ "$tasks" -gt 1 ]; then
+            engines+=(hybrid)
+        fi
 
-            if [ "$tasks" -eq 1 ]; then
-                tasks_per_node=$tasks
+        for engine in "${engines[@]}"; do
+            if [ "$engine" = "hybrid" ]; then
+                LOG_DIR="$LOG_ROOT/${size_a_k}k_${size_b_k}k/${tasks}_hybrid"
+                JOB_FILE="$JOBS_DIR/${size_a_k}k_${size_b_k}k_${tasks}t_hybrid.sbatch"
+                job_tasks=$nodes
+                job_tasks_per_node=1
+                cpus_per_task=$tasks_per_node
+                RUN_CODE="OMP_NUM_THREADS=$tasks_per_node mpirun -np $nodes --bind-to none --map-by ppr:1:node $HYBRID_BIN \"$A_FILE\" \"$B_FILE\""
             else
-                per_node=$((($tasks + 1) / 2))
-                tasks_per_node=$per_node
+                LOG_DIR="$LOG_ROOT/${size_a_k}k_${size_b_k}k/${tasks}"
+                JOB_FILE="$JOBS_DIR/${size_a_k}k_${size_b_k}k_${tasks}t.sbatch"
+                job_tasks=$tasks
+                job_tasks_per_node=$tasks_per_node
+                cpus_per_task=1
+                if [ "$tasks" -eq 1 ]; then
+                    RUN_CODE="./$SEQ_BIN $A_FILE $B_FILE"
+                else
+                    RUN_CODE="mpirun -np $tasks --bind-to core --map-by ppr:$tasks_per_node:node $MPI_BIN \"$A_FILE\" \"$B_FILE\""
+                fi
             fi
+            mkdir -p "$LOG_DIR"
 
-            if [ "$tasks" -eq 1 ]; then
-                RUN_CODE="./$SEQ_BIN $A_FILE $B_FILE"
-            else
-                RUN_CODE="mpirun -np $tasks --bind-to core --map-by ppr:$tasks_per_node:node $MPI_BIN \"$A_FILE\" \"$B_FILE\""
-            fi
+            echo "  Engine: $engine, Tasks: $tasks, Nodes: $nodes, Memória: $mem"
 
-            cat >"$JOB_FILE" <<EOF
+            for run in $(seq 1 "$num_runs"); do
+                LOG="$LOG_DIR/$run.log"
+                if [ -s "$LOG" ]; then
+                    continue
+                fi
+
+                cat >"$JOB_FILE" <<EOF
 #!/bin/bash
-#SBATCH --job-name="${size_a_k}${size_b_k}${tasks}"
+#SBATCH --job-name="${size_a_k}${size_b_k}${tasks}${engine:0:1}"
 #SBATCH --nodes=$nodes
-#SBATCH --ntasks=$tasks
-#SBATCH --ntasks-per-node=$tasks_per_node
+#SBATCH --ntasks=$job_tasks
+#SBATCH --ntasks-per-node=$job_tasks_per_node
+#SBATCH --cpus-per-task=$cpus_per_task
 #SBATCH --mem=$mem
 #SBATCH --time=$time
 #SBATCH --output=$LOG
@@ -122,13 +148,14 @@ for size in "${input_sizes[@]}"; do
 $RUN_CODE
 EOF
 
-            echo -n "    Submetendo $JOB_FILE..."
+                echo -n "    Submetendo $JOB_FILE..."
 
-            while squeue -u "$USER" --noheader | grep -q .; do
-                sleep 0.5
-            done
+                while squeue -u "$USER" --noheader | grep -q .; do
+                    sleep 0.5
+                done
 
-            sbatch "$JOB_FILE"
+                sbatch "$JOB_FILE"
+            done
         done
     done
 done
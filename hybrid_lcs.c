@@ -0,0 +1,377 @@
+#include <mpi.h>
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "seq_loader.h"
+
+#ifndef max
+#define max(a, b) (((a) > (b)) ? (a) : (b))
+#endif
+
+#ifndef min
+#define min(a, b) (((a) < (b)) ? (a) : (b))
+#endif
+
+#define BLOCK_SIZE 192  // Default tile edge, ~192x192x2 = 73KB, leaves space for other variables
+#define SCORE_TAG 100   // Tag for sending the final score to the root
+#define BOUNDARY_TAG 0  // Tag of strip boundary segments sent to the next rank
+
+typedef unsigned short matrix_element_type;
+#define MATRIX_ELEMENT_MAX 65535  // Largest score a matrix element holds
+
+// Column strip of a rank and the state of its intra-node wavefront. The strip
+// is cut into row bands of tile_height and column tiles of tile_width; only
+// the bottom row of every tile column and one column of the matrix are kept
+typedef struct {
+    char *strip_a;  // Characters of A owned by this rank
+    char *sequence_b;
+    int strip_width;
+    int sequence_b_length;
+    int tile_height;
+    int tile_width;
+    int row_bands;
+    int col_tiles;
+    // Bottom rows, tile_width + 1 values per tile column with the corner first.
+    // Zero at the start, which is the top border of the matrix
+    matrix_element_type *row_borders;
+    // Column left of the next tile to run, indexed by matrix row. Holds the
+    // boundary received from the previous rank and ends as the right column of
+    // the strip, which is what the next rank receives
+    matrix_element_type *column;
+    char *tile_done;  // Dependency sentinels, one per tile
+} strip_context;
+
+// ========================================
+// STRIP DISTRIBUTION FUNCTIONS
+// ========================================
+
+/**
+ * First column of A owned by a rank. Strips differ by at most one column
+ * @param rank Rank of the strip
+ * @param active_ranks Number of ranks that own a strip
+ * @param sequence_a_length Length of the first sequence
+ * @return Index of the first character of the strip
+ */
+int strip_start(int rank, int active_ranks, int sequence_a_length) {
+    return (int)((long)rank * sequence_a_length / active_ranks);
+}
+
+/**
+ * Parses a tile shape given with -t, HxW or a single edge for square tiles
+ * @param text Tile shape
+ * @param tile_height Parsed rows per tile
+ * @param tile_width Parsed columns per tile
+ * @return 1 on success, 0 for a malformed shape
+ */
+int parse_tile_shape(const char *text, int *tile_height, int *tile_width) {
+    int height, width;
+    int fields = sscanf(text, "%dx%d", &height, &width);
+    if (fields == 1) {
+        width = height;
+    } else if (fields != 2) {
+        return 0;
+    }
+    if (height <= 0 || width <= 0) {
+        return 0;
+    }
+    *tile_height = height;
+    *tile_width = width;
+    return 1;
+}
+
+// ========================================
+// LCS COMPUTATION FUNCTIONS
+// ========================================
+
+/**
+ * Computes the tile at a row band and tile column of the strip. top holds the
+ * row above the tile with the top-left corner in top[0], left holds the column
+ * left of the tile indexed by matrix row. Both are updated in place: top
+ * becomes the bottom row, with the last value of the left column as the corner
+ * of the tile below, and left becomes the right column of the tile
+ * @param context Strip of this rank
+ * @param band Row band of the tile
+ * @param tile_col Tile column of the tile
+ */
+void compute_tile(const strip_context *context, int band, int tile_col) {
+    int row_start = band * context->tile_height + 1;
+    int row_end = min(row_start + context->tile_height - 1, context->sequence_b_length);
+    int col_start = tile_col * context->tile_width;
+    int width = min(context->tile_width, context->strip_width - col_start);
+    const char *tile_a = context->strip_a + col_start;
+    matrix_element_type *restrict top =
+        context->row_borders + (size_t)tile_col * (context->tile_width + 1);
+    matrix_element_type *restrict left = context->column;
+
+    for (int i = row_start; i <= row_end; i++) {
+        char character_b = context->sequence_b[i - 1];
+        matrix_element_type diagonal = top[0];
+        matrix_element_type value = left[i];
+        top[0] = value;
+        for (int j = 1; j <= width; j++) {
+            matrix_element_type up = top[j];
+            if (tile_a[j - 1] == character_b) {
+                // Characters match: take diagonal value + 1
+                value = diagonal + 1;
+            } else {
+                // Characters don't match: take maximum of left and top
+                value = max(up, value);
+            }
+            diagonal = up;
+            top[j] = value;
+        }
+        left[i] = value;
+    }
+}
+
+/**
+ * Creates the OpenMP tasks of one row band. Every tile depends on the tile
+ * above and the tile to the left, so bands created earlier keep running
+ * while the master thread goes back to communication
+ * @param context Strip of this rank
+ * @param band Row band to schedule
+ */
+void schedule_band(strip_context *context, int band) {
+    static char border = 0;  // Never written, stands in for tiles outside the strip
+
+    for (int tile_col = 0; tile_col < context->col_tiles; tile_col++) {
+        char *self = &context->tile_done[(size_t)band * context->col_tiles + tile_col];
+        char *up = band > 0 ? self - context->col_tiles : &border;
+        char *left = tile_col > 0 ? self - 1 : &border;
+
+#pragma omp task firstprivate(band, tile_col) depend(in : *up, *left) depend(out : *self)
+        compute_tile(context, band, tile_col);
+    }
+}
+
+// ========================================
+// MPI COMMUNICATION FUNCTIONS
+// ========================================
+
+/**
+ * Runs the strip of this rank. Only the master thread talks to MPI
+ * (MPI_THREAD_FUNNELED): it receives the boundary of the previous strip one
+ * row band at a time, directly into the column buffer, and schedules a band as
+ * soon as its boundary is there. While a boundary is pending it finishes and
+ * sends earlier bands, taking part in the tiles through taskwait, so the next
+ * rank gets every band as early as possible even with a single thread. Threads
+ * of the same rank share the strip in memory, only strip boundaries go over MPI
+ * @param context Strip of this rank
+ * @param previous_rank Rank of the strip on the left, MPI_PROC_NULL if none
+ * @param next_rank Rank of the strip on the right, MPI_PROC_NULL if none
+ */
+void run_strip_wavefront(strip_context *context, int previous_rank, int next_rank) {
+    int row_bands = context->row_bands;
+    MPI_Request *receive_requests = (MPI_Request *)malloc(row_bands * sizeof(MPI_Request));
+    MPI_Request *send_requests = (MPI_Request *)malloc(row_bands * sizeof(MPI_Request));
+    if (receive_requests == NULL || send_requests == NULL) {
+        printf("Error allocating memory for boundary requests.\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    // Every band of the boundary has its own rows of the column, so all
+    // receives are posted up front and land in place
+    for (int band = 0; band < row_bands; band++) {
+        int row_start = band * context->tile_height + 1;
+        int rows = min(context->tile_height, context->sequence_b_length - row_start + 1);
+        MPI_Irecv(&context->column[row_start], rows, MPI_UNSIGNED_SHORT, previous_rank,
+                  BOUNDARY_TAG, MPI_COMM_WORLD, &receive_requests[band]);
+    }
+
+#pragma omp parallel
+#pragma omp master
+    {
+        int next_send = 0;
+
+        for (int band = 0; band < row_bands; band++) {
+            int received = 0;
+            MPI_Test(&receive_requests[band], &received, MPI_STATUS_IGNORE);
+            while (!received) {
+                if (next_send < band) {
+                    // Complete the oldest unsent band while the boundary is on its way
+                    char *last_tile =
+                        &context->tile_done[(size_t)next_send * context->col_tiles +
+                                            context->col_tiles - 1];
+#pragma omp taskwait depend(in : *last_tile)
+                    int row_start = next_send * context->tile_height + 1;
+                    int rows =
+                        min(context->tile_height, context->sequence_b_length - row_start + 1);
+                    MPI_Isend(&context->column[row_start], rows, MPI_UNSIGNED_SHORT, next_rank,
+                              BOUNDARY_TAG, MPI_COMM_WORLD, &send_requests[next_send]);
+                    next_send++;
+                }
+                MPI_Test(&receive_requests[band], &received, MPI_STATUS_IGNORE);
+            }
+            schedule_band(context, band);
+        }
+
+        // Send the remaining bands in order as they complete
+        for (; next_send < row_bands; next_send++) {
+            char *last_tile = &context->tile_done[(size_t)next_send * context->col_tiles +
+                                                  context->col_tiles - 1];
+#pragma omp taskwait depend(in : *last_tile)
+            int row_start = next_send * context->tile_height + 1;
+            int rows = min(context->tile_height, context->sequence_b_length - row_start + 1);
+            MPI_Isend(&context->column[row_start], rows, MPI_UNSIGNED_SHORT, next_rank,
+                      BOUNDARY_TAG, MPI_COMM_WORLD, &send_requests[next_send]);
+        }
+    }
+
+    MPI_Waitall(row_bands, send_requests, MPI_STATUSES_IGNORE);
+    free(receive_requests);
+    free(send_requests);
+}
+
+// ========================================
+// MAIN FUNCTION
+// ========================================
+
+int main(int argc, char **argv) {
+    int current_rank, world_size, thread_support;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &thread_support);
+    MPI_Comm_rank(MPI_COMM_WORLD, &current_rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &world_size);
+
+    if (thread_support < MPI_THREAD_FUNNELED) {
+        if (current_rank == 0) {
+            printf("The MPI library does not support MPI_THREAD_FUNNELED.\n");
+        }
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    // Every rank parses the options, mpirun passes them to all
+    int tile_height = BLOCK_SIZE, tile_width = BLOCK_SIZE;
+    int option, valid_options = 1;
+    while ((option = getopt(argc, argv, "t:")) != -1) {
+        if (option == 't') {
+            valid_options = valid_options && parse_tile_shape(optarg, &tile_height, &tile_width);
+        } else {
+            valid_options = 0;
+        }
+    }
+    if (!valid_options || argc - optind < 2) {
+        if (current_rank == 0) {
+            printf("Usage: mpirun -np <num_nodes> %s [-t HxW] <fileA.in> <fileB.in>\n", argv[0]);
+        }
+        MPI_Finalize();
+        return EXIT_FAILURE;
+    }
+
+    char *sequence_a = NULL, *sequence_b = NULL;
+    int sequence_a_length = 0, sequence_b_length = 0;
+
+    // Root process maps the input files, the first record of each is the sequence
+    seq_records file_a, file_b;
+    if (current_rank == 0) {
+        file_a = seq_load_records(argv[optind], SEQ_JOIN_LINES);
+        file_b = seq_load_records(argv[optind + 1], SEQ_JOIN_LINES);
+        sequence_a = file_a.seqs[0];
+        sequence_b = file_b.seqs[0];
+        sequence_a_length = file_a.lengths[0];
+        sequence_b_length = file_b.lengths[0];
+    }
+
+    // 16-bit cells, longer alignments wrap around
+    if (current_rank == 0 && min(sequence_a_length, sequence_b_length) > MATRIX_ELEMENT_MAX) {
+        printf("Warning: scores above %d overflow matrix_element_type.\n", MATRIX_ELEMENT_MAX);
+    }
+
+    MPI_Bcast(&sequence_a_length, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    MPI_Bcast(&sequence_b_length, 1, MPI_INT, 0, MPI_COMM_WORLD);
+
+    // Every strip needs all of B but only its own columns of A
+    if (current_rank != 0) {
+        sequence_b = (char *)malloc((sequence_b_length + 1) * sizeof(char));
+    }
+    MPI_Bcast(sequence_b, sequence_b_length + 1, MPI_CHAR, 0, MPI_COMM_WORLD);
+
+    // Ranks beyond the length of A would own empty strips and stay idle
+    int active_ranks = max(min(world_size, sequence_a_length), 1);
+    int *strip_counts = (int *)calloc(world_size, sizeof(int));
+    int *strip_offsets = (int *)calloc(world_size, sizeof(int));
+    for (int rank = 0; rank < active_ranks; rank++) {
+        strip_offsets[rank] = strip_start(rank, active_ranks, sequence_a_length);
+        strip_counts[rank] = strip_start(rank + 1, active_ranks, sequence_a_length) -
+                             strip_offsets[rank];
+    }
+
+    strip_context context;
+    memset(&context, 0, sizeof(context));
+    context.strip_width = strip_counts[current_rank];
+    context.sequence_b = sequence_b;
+    context.sequence_b_length = sequence_b_length;
+    context.tile_height = tile_height;
+    context.tile_width = tile_width;
+    context.row_bands = (sequence_b_length + tile_height - 1) / tile_height;
+    context.col_tiles = (context.strip_width + tile_width - 1) / tile_width;
+    context.strip_a = (char *)malloc(context.strip_width + 1);
+    context.row_borders = (matrix_element_type *)calloc(
+        (size_t)context.col_tiles * (tile_width + 1), sizeof(matrix_element_type));
+    context.column =
+        (matrix_element_type *)calloc(sequence_b_length + 1, sizeof(matrix_element_type));
+    context.tile_done = (char *)calloc((size_t)context.row_bands * context.col_tiles + 1, 1);
+    if (context.strip_a == NULL || context.row_borders == NULL || context.column == NULL ||
+        context.tile_done == NULL) {
+        printf("Error allocating memory for the strip of rank %d.\n", current_rank);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    MPI_Scatterv(sequence_a, strip_counts, strip_offsets, MPI_CHAR, context.strip_a,
+                 context.strip_width, MPI_CHAR, 0, MPI_COMM_WORLD);
+
+    // Start timing
+    double start_time, end_time;
+    MPI_Barrier(MPI_COMM_WORLD);
+    start_time = MPI_Wtime();
+
+    // *** WAVEFRONT ALGORITHM EXECUTION ***
+    int last_rank = active_ranks - 1;
+    if (current_rank < active_ranks && context.strip_width > 0) {
+        int previous_rank = current_rank > 0 ? current_rank - 1 : MPI_PROC_NULL;
+        int next_rank = current_rank < last_rank ? current_rank + 1 : MPI_PROC_NULL;
+        run_strip_wavefront(&context, previous_rank, next_rank);
+    }
+
+    // The last strip ends with the right column of the matrix, its last row is the score
+    matrix_element_type final_lcs_score = 0;
+    if (current_rank == last_rank) {
+        final_lcs_score = context.column[sequence_b_length];
+        if (last_rank != 0) {
+            MPI_Send(&final_lcs_score, 1, MPI_UNSIGNED_SHORT, 0, SCORE_TAG, MPI_COMM_WORLD);
+        }
+    }
+    if (current_rank == 0 && last_rank != 0) {
+        MPI_Recv(&final_lcs_score, 1, MPI_UNSIGNED_SHORT, last_rank, SCORE_TAG, MPI_COMM_WORLD,
+                 MPI_STATUS_IGNORE);
+    }
+
+    // End timing
+    MPI_Barrier(MPI_COMM_WORLD);
+    end_time = MPI_Wtime();
+
+    // Collect and print results
+    if (current_rank == 0) {
+        printf("\nScore: %d\n", final_lcs_score);
+        printf("PARALLEL: %fs\n", end_time - start_time);
+    }
+
+    // Cleanup
+    free(context.strip_a);
+    free(context.row_borders);
+    free(context.column);
+    free(context.tile_done);
+    free(strip_counts);
+    free(strip_offsets);
+    if (current_rank == 0) {
+        seq_free_records(&file_a);
+        seq_free_records(&file_b);
+    } else {
+        free(sequence_b);
+    }
+    MPI_Finalize();
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,559 @@
+// Benchmark driver for the LCS engines. Every engine runs as a subprocess on
+// generated inputs. A run is timed by the engine itself, from the last
+// "Total time:" (OpenMP) or "PARALLEL:" (MPI, hybrid) it prints, so GCUPS
+// leave out process start, MPI launch and input loading; engines that print
+// neither fall back to wall time. The wall time from fork to exit, on
+// CLOCK_MONOTONIC, is reported next to it, with the peak RSS taken from
+// wait4. After the warmup runs an engine repeats until the 95% confidence
+// interval of the mean is within the target or the repetition cap is hit.
+// Every run's score is checked against a bit-parallel reference computed
+// here, and results go out as JSON and CSV.
+#define _GNU_SOURCE
+#include <errno.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAX_ENGINES 32
+#define MAX_SIZES 32
+#define MAX_RUNS 1000
+
+// An engine is a command line, the two input files are appended to it
+typedef struct {
+    char name[64];
+    char command[1024];
+} engine;
+
+// Engines run by default, on the sequential and OpenMP binaries
+typedef struct {
+    const char *name;
+    int omp;  // 1 for the OpenMP binary, 0 for the sequential one
+    const char *args;
+} builtin_engine;
+
+static const builtin_engine builtin_engines[] = {
+    {"seq-linear", 0, "-m linear"},     {"seq-bitpar", 0, "-m bitpar"},
+    {"omp-diagonal", 1, "-m diagonal"}, {"omp-linear", 1, "-m linear"},
+    {"omp-tiled", 1, "-m tiled"},       {"omp-pipeline", 1, "-m pipeline"},
+    {"omp-bits", 1, "-m bits"},
+};
+
+// Benchmark settings, see usage
+typedef struct {
+    const char *seq_binary;
+    const char *omp_binary;
+    const char *alphabet;
+    double similarity;
+    unsigned seed;
+    int warmup;
+    int min_runs;
+    int max_runs;
+    double ci_target;  // Half-width of the 95% interval relative to the mean
+    const char *json_path;
+    const char *csv_path;
+} bench_config;
+
+// Timings of one engine on one input. median to ci95 and gcups use the
+// engine's own time, or the wall time when engine_timed is 0
+typedef struct {
+    int runs;
+    double median, p95, mean, ci95;
+    double wall_median;
+    int engine_timed;
+    double gcups;
+    long peak_rss_kb;
+    long score;
+    int score_ok;
+} bench_result;
+
+/**
+ * Seconds on the monotonic clock
+ */
+double monotonic_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// ========================================
+// INPUT GENERATION
+// ========================================
+
+/**
+ * Random sequence over an alphabet
+ * @param length Characters to generate
+ * @param alphabet Symbols to draw from
+ * @param state Generator state
+ * @return malloc'd sequence
+ */
+char *random_sequence(size_t length, const char *alphabet, unsigned *state) {
+    size_t symbols = strlen(alphabet);
+    char *seq = (char *)malloc(length + 1);
+    if (!seq) {
+        fprintf(stderr, "Error allocating memory for an input\n");
+        exit(EXIT_FAILURE);
+    }
+    for (size_t i = 0; i < length; i++) seq[i] = alphabet[rand_r(state) % symbols];
+    seq[length] = '\0';
+    return seq;
+}
+
+/**
+ * Second sequence of a pair: a copy of a where each position is kept with
+ * probability similarity and otherwise substituted, deleted or followed by an
+ * insertion, cut or padded to length
+ * @param a First sequence
+ * @param length_a Length of a
+ * @param length Characters to generate
+ * @param config Alphabet and similarity
+ * @param state Generator state
+ * @return malloc'd sequence
+ */
+char *similar_sequence(const char *a, size_t length_a, size_t length, const bench_config *config,
+                       unsigned *state) {
+    size_t symbols = strlen(config->alphabet);
+    char *seq = random_sequence(length, config->alphabet, state);
+    size_t out = 0;
+    for (size_t i = 0; i < length_a && out < length; i++) {
+        if ((double)rand_r(state) / RAND_MAX < config->similarity) {
+            seq[out++] = a[i];
+            continue;
+        }
+        int edit = rand_r(state) % 3;
+        if (edit == 0) {
+            seq[out++] = config->alphabet[rand_r(state) % symbols];
+        } else if (edit == 2) {
+            seq[out++] = a[i];
+            if (out < length) seq[out++] = config->alphabet[rand_r(state) % symbols];
+        }
+    }
+    // whatever is left stays random
+    return seq;
+}
+
+/**
+ * Writes a sequence to a file
+ * @param path File to write
+ * @param seq Sequence
+ */
+void write_sequence(const char *path, const char *seq) {
+    FILE *f = fopen(path, "w");
+    if (!f || fputs(seq, f) < 0 || fclose(f) != 0) {
+        fprintf(stderr, "Error writing file %s\n", path);
+        exit(EXIT_FAILURE);
+    }
+}
+
+/**
+ * Reference score, bit-parallel so it is exact at any length
+ * @param a First sequence
+ * @param length_a Length of a
+ * @param b Second sequence
+ * @param length_b Length of b
+ * @return LCS length
+ */
+long reference_score(const char *a, size_t length_a, const char *b, size_t length_b) {
+    size_t words = (length_a + 63) / 64;
+    if (words == 0 || length_b == 0) return 0;
+
+    uint64_t *masks = (uint64_t *)calloc(256 * words, sizeof(uint64_t));
+    uint64_t *v = (uint64_t *)malloc(words * sizeof(uint64_t));
+    if (!masks || !v) {
+        fprintf(stderr, "Error allocating memory for the reference\n");
+        exit(EXIT_FAILURE);
+    }
+    for (size_t j = 0; j < length_a; j++)
+        masks[(unsigned char)a[j] * words + j / 64] |= (uint64_t)1 << (j % 64);
+    for (size_t k = 0; k < words; k++) v[k] = ~(uint64_t)0;
+
+    for (size_t i = 0; i < length_b; i++) {
+        const uint64_t *m = masks + (unsigned char)b[i] * words;
+        uint64_t carry = 0;
+        for (size_t k = 0; k < words; k++) {
+            uint64_t u = v[k] & m[k], sum;
+            uint64_t c1 = __builtin_add_overflow(v[k], u, &sum);
+            uint64_t c2 = __builtin_add_overflow(sum, carry, &sum);
+            carry = c1 | c2;
+            v[k] = sum | (v[k] & ~u);
+        }
+    }
+
+    long score = 0;
+    for (size_t k = 0; k < words; k++) {
+        uint64_t valid = ~(uint64_t)0;
+        if (k == words - 1 && length_a % 64 != 0) valid = ((uint64_t)1 << (length_a % 64)) - 1;
+        score += __builtin_popcountll(~v[k] & valid);
+    }
+    free(masks);
+    free(v);
+    return score;
+}
+
+// ========================================
+// RUNNING ENGINES
+// ========================================
+
+/**
+ * Runs an engine once through /bin/sh
+ * @param eng Engine to run
+ * @param path_a First input file
+ * @param path_b Second input file
+ * @param seconds Wall time from fork to exit
+ * @param engine_seconds Time the engine reported, -1 if it printed none
+ * @param peak_rss_kb Peak resident set of the engine
+ * @return Score it printed, -1 if it failed or printed none
+ */
+long run_engine(const engine *eng, const char *path_a, const char *path_b, double *seconds,
+                double *engine_seconds, long *peak_rss_kb) {
+    char command[2048];
+    snprintf(command, sizeof(command), "exec %s '%s' '%s'", eng->command, path_a, path_b);
+
+    int out[2];
+    if (pipe(out) != 0) {
+        fprintf(stderr, "Error creating a pipe\n");
+        exit(EXIT_FAILURE);
+    }
+    double start = monotonic_seconds();
+    pid_t pid = fork();
+    if (pid == 0) {
+        dup2(out[1], STDOUT_FILENO);
+        close(out[0]);
+        close(out[1]);
+        execl("/bin/sh", "sh", "-c", command, (char *)NULL);
+        _exit(127);
+    }
+    close(out[1]);
+
+    // the score is the number after the last "Score:" the engine prints, the
+    // time likewise after the last "Total time:" or "PARALLEL:"
+    long score = -1;
+    *engine_seconds = -1;
+    FILE *f = fdopen(out[0], "r");
+    char line[4096];
+    while (fgets(line, sizeof(line), f)) {
+        char *found = strstr(line, "Score:");
+        if (found) score = strtol(found + 6, NULL, 10);
+        found = strstr(line, "Total time:");
+        if (found) *engine_seconds = strtod(found + 11, NULL);
+        found = strstr(line, "PARALLEL:");
+        if (found) *engine_seconds = strtod(found + 9, NULL);
+    }
+    fclose(f);
+
+    int status;
+    struct rusage usage;
+    while (wait4(pid, &status, 0, &usage) < 0 && errno == EINTR) {
+    }
+    *seconds = monotonic_seconds() - start;
+    *peak_rss_kb = usage.ru_maxrss;
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) return -1;
+    return score;
+}
+
+/**
+ * Two-sided 95% Student t quantile
+ * @param dof Degrees of freedom
+ */
+double t_quantile_95(int dof) {
+    static const double table[] = {0,     12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365,
+                                    2.306, 2.262,  2.228, 2.201, 2.179, 2.160, 2.145, 2.131,
+                                    2.120, 2.110,  2.101, 2.093, 2.086, 2.080, 2.074, 2.069,
+                                    2.064, 2.060,  2.056, 2.052, 2.048, 2.045, 2.042};
+    if (dof < (int)(sizeof(table) / sizeof(table[0]))) return table[dof];
+    return 1.96;
+}
+
+int compare_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * Median of samples, which are sorted in place
+ * @param samples Values
+ * @param count Number of values, at least one
+ */
+double median_of(double *samples, int count) {
+    qsort(samples, count, sizeof(double), compare_double);
+    return count % 2 ? samples[count / 2] : (samples[count / 2 - 1] + samples[count / 2]) / 2;
+}
+
+/**
+ * Benchmarks one engine on one input pair
+ * @param eng Engine
+ * @param path_a First input file
+ * @param path_b Second input file
+ * @param cells Cells of the DP table, for GCUPS
+ * @param reference Expected score
+ * @param config Warmup and repetition settings
+ * @return Statistics of the timed runs
+ */
+bench_result bench_engine(const engine *eng, const char *path_a, const char *path_b, double cells,
+                          long reference, const bench_config *config) {
+    bench_result result = {0};
+    double samples[MAX_RUNS], wall_samples[MAX_RUNS];
+    double seconds, engine_seconds;
+    long rss;
+
+    result.score_ok = 1;
+    result.engine_timed = 1;
+    for (int w = 0; w < config->warmup; w++)
+        run_engine(eng, path_a, path_b, &seconds, &engine_seconds, &rss);
+
+    double sum = 0, sum_sq = 0;
+    while (result.runs < config->max_runs) {
+        long score = run_engine(eng, path_a, path_b, &seconds, &engine_seconds, &rss);
+        // one run without its own time and the engine is timed by the wall
+        // clock only, so the samples never mix the two
+        if (engine_seconds < 0 && result.engine_timed) {
+            result.engine_timed = 0;
+            sum = sum_sq = 0;
+            for (int k = 0; k < result.runs; k++) {
+                samples[k] = wall_samples[k];
+                sum += samples[k];
+                sum_sq += samples[k] * samples[k];
+            }
+        }
+        wall_samples[result.runs] = seconds;
+        if (result.engine_timed) seconds = engine_seconds;
+        samples[result.runs++] = seconds;
+        sum += seconds;
+        sum_sq += seconds * seconds;
+        if (rss > result.peak_rss_kb) result.peak_rss_kb = rss;
+        result.score = score;
+        if (score != reference) result.score_ok = 0;
+
+        result.mean = sum / result.runs;
+        if (result.runs > 1) {
+            double variance = (sum_sq - sum * result.mean) / (result.runs - 1);
+            result.ci95 = t_quantile_95(result.runs - 1) * sqrt(variance > 0 ? variance : 0) /
+                          sqrt(result.runs);
+        }
+        // a wrong score won't get better with more runs
+        if (!result.score_ok) break;
+        if (result.runs >= config->min_runs && result.ci95 <= config->ci_target * result.mean)
+            break;
+    }
+
+    result.median = median_of(samples, result.runs);
+    // nearest rank, samples are sorted by median_of
+    int rank95 = (int)ceil(0.95 * result.runs) - 1;
+    result.p95 = samples[rank95 < 0 ? 0 : rank95];
+    result.wall_median = median_of(wall_samples, result.runs);
+    result.gcups = cells / result.median / 1e9;
+    return result;
+}
+
+// ========================================
+// MAIN FUNCTION
+// ========================================
+
+void usage(const char *prog) {
+    fprintf(stderr,
+            "Usage: %s [-s seq_binary] [-p omp_binary] [-e engines] [-E name=command]... "
+            "[-n sizes]\n"
+            "          [-a alphabet] [-y similarity] [-r seed] [-w warmup] [-R min:max runs] "
+            "[-c ci]\n"
+            "          [-j results.json] [-o results.csv]\n",
+            prog);
+    fprintf(stderr, "  seq_binary, omp_binary: default ./lcs_seq and ./lcs_omp\n");
+    fprintf(stderr, "  engines: comma-separated built-in names, all by default:");
+    for (size_t k = 0; k < sizeof(builtin_engines) / sizeof(builtin_engines[0]); k++)
+        fprintf(stderr, " %s", builtin_engines[k].name);
+    fprintf(stderr,
+            "\n  -E adds an engine run as 'command fileA fileB', e.g. "
+            "-E 'mpi4=mpirun -np 4 ./lcs_mpi'\n"
+            "  sizes: comma-separated N for NxN or NxM, default 1000,4000\n"
+            "  similarity: chance a character of A is kept in B, default 0.25\n"
+            "  ci: 95%% interval half-width relative to the mean, default 0.02\n");
+    exit(EXIT_FAILURE);
+}
+
+int main(int argc, char **argv) {
+    bench_config config = {"./lcs_seq", "./lcs_omp", "ACGT", 0.25, 1, 1, 5, 30, 0.02, NULL,
+                           NULL};
+    const char *engine_names = NULL;
+    const char *sizes_text = "1000,4000";
+    engine engines[MAX_ENGINES];
+    int engine_count = 0;
+    engine extra[MAX_ENGINES];
+    int extra_count = 0;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "s:p:e:E:n:a:y:r:w:R:c:j:o:")) != -1) {
+        switch (opt) {
+            case 's':
+                config.seq_binary = optarg;
+                break;
+            case 'p':
+                config.omp_binary = optarg;
+                break;
+            case 'e':
+                engine_names = optarg;
+                break;
+            case 'E': {
+                char *eq = strchr(optarg, '=');
+                if (!eq || extra_count == MAX_ENGINES) usage(argv[0]);
+                snprintf(extra[extra_count].name, sizeof(extra[0].name), "%.*s",
+                         (int)(eq - optarg), optarg);
+                snprintf(extra[extra_count].command, sizeof(extra[0].command), "%s", eq + 1);
+                extra_count++;
+                break;
+            }
+            case 'n':
+                sizes_text = optarg;
+                break;
+            case 'a':
+                config.alphabet = optarg;
+                if (strlen(optarg) == 0) usage(argv[0]);
+                break;
+            case 'y':
+                config.similarity = atof(optarg);
+                break;
+            case 'r':
+                config.seed = atoi(optarg);
+                break;
+            case 'w':
+                config.warmup = atoi(optarg);
+                break;
+            case 'R':
+                if (sscanf(optarg, "%d:%d", &config.min_runs, &config.max_runs) != 2 ||
+                    config.min_runs < 1 || config.max_runs < config.min_runs ||
+                    config.max_runs > MAX_RUNS)
+                    usage(argv[0]);
+                break;
+            case 'c':
+                config.ci_target = atof(optarg);
+                break;
+            case 'j':
+                config.json_path = optarg;
+                break;
+            case 'o':
+                config.csv_path = optarg;
+                break;
+            default:
+                usage(argv[0]);
+        }
+    }
+
+    // built-in engines, all of them or the ones named with -e
+    for (size_t k = 0; k < sizeof(builtin_engines) / sizeof(builtin_engines[0]); k++) {
+        const builtin_engine *b = &builtin_engines[k];
+        if (engine_names) {
+            const char *at = strstr(engine_names, b->name);
+            size_t len = strlen(b->name);
+            int listed = 0;
+            while (at && !listed) {
+                listed = (at == engine_names || at[-1] == ',') && (at[len] == ',' || !at[len]);
+                at = strstr(at + 1, b->name);
+            }
+            if (!listed) continue;
+        }
+        snprintf(engines[engine_count].name, sizeof(engines[0].name), "%s", b->name);
+        snprintf(engines[engine_count].command, sizeof(engines[0].command), "%s %s",
+                 b->omp ? config.omp_binary : config.seq_binary, b->args);
+        engine_count++;
+    }
+    for (int k = 0; k < extra_count && engine_count < MAX_ENGINES; k++)
+        engines[engine_count++] = extra[k];
+    if (engine_count == 0) usage(argv[0]);
+
+    // input sizes
+    size_t sizes_a[MAX_SIZES], sizes_b[MAX_SIZES];
+    int size_count = 0;
+    for (const char *p = sizes_text; *p && size_count < MAX_SIZES;) {
+        char *end;
+        sizes_a[size_count] = strtoul(p, &end, 10);
+        sizes_b[size_count] = sizes_a[size_count];
+        if (*end == 'x') sizes_b[size_count] = strtoul(end + 1, &end, 10);
+        if (end == p || (*end && *end != ',')) usage(argv[0]);
+        size_count++;
+        p = *end ? end + 1 : end;
+    }
+
+    char dir[] = "/tmp/lcs_bench_XXXXXX";
+    if (!mkdtemp(dir)) {
+        fprintf(stderr, "Error creating a directory for the inputs\n");
+        exit(EXIT_FAILURE);
+    }
+    char path_a[64], path_b[64];
+    snprintf(path_a, sizeof(path_a), "%s/A.in", dir);
+    snprintf(path_b, sizeof(path_b), "%s/B.in", dir);
+
+    FILE *json = config.json_path ? fopen(config.json_path, "w") : NULL;
+    FILE *csv = config.csv_path ? fopen(config.csv_path, "w") : NULL;
+    if ((config.json_path && !json) || (config.csv_path && !csv)) {
+        fprintf(stderr, "Error writing the results\n");
+        exit(EXIT_FAILURE);
+    }
+    if (json) fprintf(json, "[\n");
+    if (csv)
+        fprintf(csv, "engine,size_a,size_b,alphabet,similarity,runs,timing,median_s,p95_s,mean_s,"
+                     "ci95_s,wall_median_s,gcups,peak_rss_kb,score,reference,score_ok\n");
+
+    printf("%-14s %9s %9s %5s %6s %11s %11s %11s %9s %11s %s\n", "engine", "size_a", "size_b",
+           "runs", "timing", "median_s", "p95_s", "wall_s", "GCUPS", "peak_rss_kb", "score");
+    int mismatches = 0, first_record = 1;
+    unsigned state = config.seed;
+    for (int s = 0; s < size_count; s++) {
+        char *a = random_sequence(sizes_a[s], config.alphabet, &state);
+        char *b = similar_sequence(a, sizes_a[s], sizes_b[s], &config, &state);
+        write_sequence(path_a, a);
+        write_sequence(path_b, b);
+        long reference = reference_score(a, sizes_a[s], b, sizes_b[s]);
+        double cells = (double)sizes_a[s] * sizes_b[s];
+
+        for (int e = 0; e < engine_count; e++) {
+            bench_result r = bench_engine(&engines[e], path_a, path_b, cells, reference, &config);
+            mismatches += !r.score_ok;
+            const char *timing = r.engine_timed ? "engine" : "wall";
+            printf("%-14s %9zu %9zu %5d %6s %11.6f %11.6f %11.6f %9.3f %11ld %ld%s\n",
+                   engines[e].name, sizes_a[s], sizes_b[s], r.runs, timing, r.median, r.p95,
+                   r.wall_median, r.gcups, r.peak_rss_kb, r.score, r.score_ok ? "" : " MISMATCH");
+            fflush(stdout);
+
+            if (json)
+                fprintf(json,
+                        "%s  {\"engine\": \"%s\", \"size_a\": %zu, \"size_b\": %zu, "
+                        "\"alphabet\": \"%s\", \"similarity\": %g, \"runs\": %d, "
+                        "\"timing\": \"%s\", \"median_s\": %.9f, \"p95_s\": %.9f, "
+                        "\"mean_s\": %.9f, \"ci95_s\": %.9f, \"wall_median_s\": %.9f, "
+                        "\"gcups\": %.6f, \"peak_rss_kb\": %ld, \"score\": %ld, "
+                        "\"reference\": %ld, \"score_ok\": %s}",
+                        first_record ? "" : ",\n", engines[e].name, sizes_a[s], sizes_b[s],
+                        config.alphabet, config.similarity, r.runs, timing, r.median, r.p95,
+                        r.mean, r.ci95, r.wall_median, r.gcups, r.peak_rss_kb, r.score, reference,
+                        r.score_ok ? "true" : "false");
+            if (csv)
+                fprintf(csv,
+                        "%s,%zu,%zu,%s,%g,%d,%s,%.9f,%.9f,%.9f,%.9f,%.9f,%.6f,%ld,%ld,%ld,%d\n",
+                        engines[e].name, sizes_a[s], sizes_b[s], config.alphabet,
+                        config.similarity, r.runs, timing, r.median, r.p95, r.mean, r.ci95,
+                        r.wall_median, r.gcups, r.peak_rss_kb, r.score, reference, r.score_ok);
+            first_record = 0;
+        }
+        free(a);
+        free(b);
+    }
+    if (json) {
+        fprintf(json, "\n]\n");
+        fclose(json);
+    }
+    if (csv) fclose(csv);
+
+    unlink(path_a);
+    unlink(path_b);
+    rmdir(dir);
+
+    if (mismatches)
+        fprintf(stderr, "%d engine/input pairs disagree with the reference\n", mismatches);
+    return mismatches ? EXIT_FAILURE : EXIT_SUCCESS;
+}
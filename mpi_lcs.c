@@ -1,7 +1,31 @@
+#include <aio.h>
+#include <errno.h>
 #include <mpi.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
+
+#include "seq_alloc.h"
+#include "seq_checkpoint.h"
+#include "seq_encode.h"
+#include "seq_loader.h"
+
+#ifdef LCS_PERF
+#include "seq_perf.h"
+
+// Counters of this rank, enabled around every compute_lcs_block of the
+// measured run and left NULL during autotuning
+static seq_perf_counters *block_counters = NULL;
+#endif
+
+#ifdef LCS_TRACE
+#include "seq_trace.h"
+
+// Timeline of this rank, recorded by process_wavefront_block during the
+// measured run and left NULL during autotuning
+static seq_trace_buffer *trace_buffer = NULL;
+#endif
 
 #ifndef max
 #define max(a, b) (((a) > (b)) ? (a) : (b))
@@ -11,29 +35,95 @@
 #define min(a, b) (((a) < (b)) ? (a) : (b))
 #endif
 
-#define DEBUGMATRIX
-#define BLOCK_SIZE 192  // ~192x192x2 = 73KB, leaves space for other variables
+/* #define DEBUGMATRIX */
+#define BLOCK_SIZE 192  // Default tile edge, ~192x192x2 = 73KB, leaves space for other variables
+#define SCORE_TAG 100   // Tag for sending the final score to the root
+#define HORIZONTAL_TAG 0  // Tag of bottom rows sent to the block below
+#define VERTICAL_TAG 1    // Tag of right columns sent to the block to the right
+#define TRACE_TAG 300     // Tag of clock probes and trace events sent to the root
+#define TRACE_SYNC_ROUNDS 16  // Clock probes per rank, the fastest round trip is kept
+#define AUTOTUNE_PREFIX_LENGTH 4096  // Characters of each sequence used by -t auto
+#define CHECKPOINT_INTERVAL 64       // Block antidiagonals between checkpoint records
+#define CHECKPOINT_RECORD_MAGIC 0x3144434552534c43ULL  // "LCSRECD1" on disk, starts every record
 
 typedef unsigned short matrix_element_type;
+#define MATRIX_ELEMENT_MAX 65535  // Largest score a matrix element holds
+
+// Block-to-rank distributions selectable with -d
+typedef enum {
+    MAPPING_ROUND_ROBIN,   // Row-major block index modulo the number of ranks
+    MAPPING_COLUMN_STRIP,  // One contiguous strip of block columns per rank
+    MAPPING_BLOCK_CYCLIC,  // Groups of block columns dealt cyclically to the ranks
+    MAPPING_2D_CYCLIC      // Blocks dealt cyclically over a 2D process grid
+} mapping_strategy;
+
+// Block-to-rank distribution of the matrix
+typedef struct {
+    mapping_strategy strategy;
+    int total_row_blocks;
+    int total_col_blocks;
+    int world_size;
+    int cyclic_width;  // Block columns per group of MAPPING_BLOCK_CYCLIC
+    int grid_rows;     // Process grid of MAPPING_2D_CYCLIC
+    int grid_cols;
+} block_mapping;
+
+// Tile shapes timed by -t auto, the product of both lists
+static const int autotune_tile_heights[] = {64, 128, 256, 512};
+static const int autotune_tile_widths[] = {64, 128, 256, 512, 1024};
+
+// Position of a block in the block grid
+typedef struct {
+    int row;
+    int col;
+} block_index;
+
+// Sequences as every rank holds them: a match profile of A and B packed
+typedef struct {
+    uint64_t *profile_a;   // Bitmap of the columns of A holding each code
+    size_t profile_words;  // Words per profile row
+    uint8_t *packed_b;     // Codes of B, symbol_bits each
+    int symbol_bits;
+} encoded_sequences;
+
+// Everything a rank needs to run its part of the wavefront
+typedef struct {
+    const encoded_sequences *sequences;
+    int sequence_a_length;
+    int sequence_b_length;
+    int current_rank;
+    int tile_height;  // Rows of B per block
+    int tile_width;   // Columns of A per block
+    block_mapping mapping;
+    block_index *work_list;  // Owned blocks in dependency order
+    int work_count;
+    int *block_slots;  // Local slot of every block of the matrix, -1 when owned elsewhere
+    matrix_element_type *local_blocks;  // Owned blocks with their halos, one slot each
+    seq_buffer local_storage;           // Backs local_blocks
+} wavefront_context;
+
+// Element (i, j) of a locally stored block. Row 0 and column 0 are the halo
+// received from the blocks above and to the left, the block itself is 1-based
+#define BLOCK_ELEMENT(block, width, i, j) (block)[(size_t)(i) * ((width) + 1) + (j)]
+
+// Element (i, j) of the full matrix, stored row by row in one block
+#define MATRIX_ELEMENT(matrix, sequence_a_length, i, j) \
+    (matrix)[(size_t)(i) * ((sequence_a_length) + 1) + (j)]
 
 // ========================================
 // MATRIX MANAGEMENT FUNCTIONS
 // ========================================
 
 /**
- * Allocates memory for a 2D matrix
+ * Allocates memory for a 2D matrix as one contiguous block, on huge pages
+ * when the system has them
  * @param sequence_a_length Length of sequence A
  * @param sequence_b_length Length of sequence B
- * @return Pointer to allocated matrix
+ * @return Buffer holding the matrix, see MATRIX_ELEMENT
  */
-matrix_element_type **allocate_lcs_matrix(int sequence_a_length, int sequence_b_length) {
-    matrix_element_type **matrix =
-        (matrix_element_type **)malloc((sequence_b_length + 1) * sizeof(matrix_element_type *));
-    for (int i = 0; i < (sequence_b_length + 1); i++) {
-        matrix[i] =
-            (matrix_element_type *)malloc((sequence_a_length + 1) * sizeof(matrix_element_type));
-    }
-    return matrix;
+seq_buffer allocate_lcs_matrix(int sequence_a_length, int sequence_b_length) {
+    return seq_buffer_alloc((size_t)(sequence_a_length + 1) * (sequence_b_length + 1) *
+                            sizeof(matrix_element_type));
 }
 
 /**
@@ -42,15 +132,15 @@ matrix_element_type **allocate_lcs_matrix(int sequence_a_length, int sequence_b_
  * @param sequence_a_length Length of sequence A
  * @param sequence_b_length Length of sequence B
  */
-void initialize_lcs_matrix(matrix_element_type **matrix, int sequence_a_length,
+void initialize_lcs_matrix(matrix_element_type *matrix, int sequence_a_length,
                            int sequence_b_length) {
     // Initialize first row (sequence A base case)
     for (int i = 0; i < (sequence_a_length + 1); i++) {
-        matrix[0][i] = 0;
+        MATRIX_ELEMENT(matrix, sequence_a_length, 0, i) = 0;
     }
     // Initialize first column (sequence B base case)
     for (int i = 1; i < (sequence_b_length + 1); i++) {
-        matrix[i][0] = 0;
+        MATRIX_ELEMENT(matrix, sequence_a_length, i, 0) = 0;
     }
 }
 
@@ -62,7 +152,7 @@ void initialize_lcs_matrix(matrix_element_type **matrix, int sequence_a_length,
  * @param sequence_a_length Length of sequence A
  * @param sequence_b_length Length of sequence B
  */
-void print_lcs_matrix(char *sequence_a, char *sequence_b, matrix_element_type **matrix,
+void print_lcs_matrix(char *sequence_a, char *sequence_b, const matrix_element_type *matrix,
                       int sequence_a_length, int sequence_b_length) {
     printf("Score Matrix:\n");
     printf("========================================\n");
@@ -79,7 +169,7 @@ void print_lcs_matrix(char *sequence_a, char *sequence_b, matrix_element_type **
             printf("%c   ", sequence_b[i - 1]);
         }
         for (int j = 0; j < sequence_a_length + 1; j++) {
-            printf("%5d   ", matrix[i][j]);
+            printf("%5d   ", MATRIX_ELEMENT(matrix, sequence_a_length, i, j));
         }
         printf("\n");
     }
@@ -88,60 +178,189 @@ void print_lcs_matrix(char *sequence_a, char *sequence_b, matrix_element_type **
 
 /**
  * Frees the allocated memory for the LCS matrix
- * @param matrix The matrix to free
- * @param sequence_b_length Length of sequence B
+ * @param matrix Buffer from allocate_lcs_matrix
  */
-void free_lcs_matrix(matrix_element_type **matrix, int sequence_b_length) {
-    for (int i = 0; i < (sequence_b_length + 1); i++) {
-        free(matrix[i]);
-    }
-    free(matrix);
+void free_lcs_matrix(seq_buffer *matrix) {
+    seq_buffer_free(matrix);
+}
+
+// ========================================
+// LOCAL BLOCK STORAGE
+// ========================================
+
+/**
+ * Allocates zeroed storage for the blocks owned by a rank, each block with its
+ * halo row and column. Only these blocks are kept, about 1/world_size of the
+ * matrix per rank. They sit in one block, on huge pages when the system has
+ * them, see seq_alloc.h
+ * @param block_count Number of owned blocks
+ * @param block_elements Elements per block including the halo
+ * @return Buffer holding the block storage
+ */
+seq_buffer allocate_local_blocks(int block_count, size_t block_elements) {
+    return seq_buffer_alloc((size_t)block_count * block_elements * sizeof(matrix_element_type));
+}
+
+/**
+ * Returns the local storage of an owned block
+ * @param context Wavefront context
+ * @param block_row_index Row index of the block
+ * @param block_col_index Column index of the block
+ * @return Pointer to the block including its halo
+ */
+matrix_element_type *get_local_block(const wavefront_context *context, int block_row_index,
+                                     int block_col_index) {
+    long block = (long)block_row_index * context->mapping.total_col_blocks + block_col_index;
+    size_t slot = context->block_slots[block];
+    return context->local_blocks +
+           slot * (size_t)(context->tile_height + 1) * (context->tile_width + 1);
+}
+
+/**
+ * Number of matrix rows in a block row, smaller for the last one
+ */
+int block_height(const wavefront_context *context, int block_row_index) {
+    int row_start = block_row_index * context->tile_height;
+    return min(row_start + context->tile_height, context->sequence_b_length) - row_start;
+}
+
+/**
+ * Number of matrix columns in a block column, smaller for the last one
+ */
+int block_width(const wavefront_context *context, int block_col_index) {
+    int col_start = block_col_index * context->tile_width;
+    return min(col_start + context->tile_width, context->sequence_a_length) - col_start;
 }
 
 // ========================================
-// FILE I/O FUNCTIONS
+// BLOCK DISTRIBUTION FUNCTIONS
 // ========================================
 
 /**
- * Reads a sequence from a file
- * @param filename Name of the file to read
- * @return Pointer to the sequence string
+ * Creates a block-to-rank distribution
+ * @param strategy Distribution strategy
+ * @param total_row_blocks Total number of row blocks
+ * @param total_col_blocks Total number of column blocks
+ * @param world_size Number of MPI processes
+ * @param cyclic_width Block columns per group for MAPPING_BLOCK_CYCLIC
+ * @return The mapping
  */
-char *read_sequence_from_file(char *filename) {
-    FILE *file_pointer = NULL;
-    long file_size = 0;
-    char *sequence = NULL;
-    int character_index = 0;
+block_mapping create_block_mapping(mapping_strategy strategy, int total_row_blocks,
+                                   int total_col_blocks, int world_size, int cyclic_width) {
+    block_mapping mapping;
+    mapping.strategy = strategy;
+    mapping.total_row_blocks = total_row_blocks;
+    mapping.total_col_blocks = total_col_blocks;
+    mapping.world_size = world_size;
+    mapping.cyclic_width = max(cyclic_width, 1);
 
-    file_pointer = fopen(filename, "rt");
-    if (file_pointer == NULL) {
-        printf("Error reading file %s\n", filename);
-        exit(1);
+    // Most square process grid: the largest divisor of world_size not above its root
+    mapping.grid_rows = 1;
+    for (int divisor = 1; divisor * divisor <= world_size; divisor++) {
+        if (world_size % divisor == 0) {
+            mapping.grid_rows = divisor;
+        }
     }
+    mapping.grid_cols = world_size / mapping.grid_rows;
+    return mapping;
+}
 
-    // Get file size
-    fseek(file_pointer, 0L, SEEK_END);
-    file_size = ftell(file_pointer);
-    rewind(file_pointer);
+/**
+ * Returns the rank that owns a block
+ * @param mapping Block distribution
+ * @param block_row_index Row index of the block
+ * @param block_col_index Column index of the block
+ * @return Owner rank
+ */
+int block_owner(const block_mapping *mapping, int block_row_index, int block_col_index) {
+    switch (mapping->strategy) {
+        case MAPPING_COLUMN_STRIP:
+            return (int)((long)block_col_index * mapping->world_size / mapping->total_col_blocks);
+        case MAPPING_BLOCK_CYCLIC:
+            return (block_col_index / mapping->cyclic_width) % mapping->world_size;
+        case MAPPING_2D_CYCLIC:
+            return (block_row_index % mapping->grid_rows) * mapping->grid_cols +
+                   block_col_index % mapping->grid_cols;
+        case MAPPING_ROUND_ROBIN:
+        default:
+            // Distributes the blocks cyclically with the mod operator: 0, 1, 2, 3, 0, 1 ...
+            return (int)(((long)block_row_index * mapping->total_col_blocks + block_col_index) %
+                         mapping->world_size);
+    }
+}
 
-    // Allocate memory for sequence
-    sequence = (char *)calloc(file_size + 1, sizeof(char));
-    if (sequence == NULL) {
-        printf("Error allocating memory for sequence %s.\n", filename);
-        exit(1);
+/**
+ * Orders blocks by anti-diagonal, then by row. Any block comes after the blocks
+ * above and to the left of it, and two ranks always list the sending and the
+ * receiving side of a halo in the same relative order
+ */
+int compare_block_dependency_order(const void *first, const void *second) {
+    const block_index *a = (const block_index *)first;
+    const block_index *b = (const block_index *)second;
+    int diagonal_a = a->row + a->col;
+    int diagonal_b = b->row + b->col;
+    if (diagonal_a != diagonal_b) {
+        return diagonal_a - diagonal_b;
     }
+    return a->row - b->row;
+}
 
-    // Read sequence character by character, ignoring newlines
-    while (!feof(file_pointer)) {
-        sequence[character_index] = fgetc(file_pointer);
-        if ((sequence[character_index] != '\n') && (sequence[character_index] != EOF)) {
-            character_index++;
+/**
+ * Builds the list of blocks owned by this rank in dependency order and
+ * allocates their storage. Only the owned rows or columns of the mapping are
+ * enumerated, a rank never walks the blocks of the others
+ * @param context Wavefront context, mapping and rank already set
+ */
+void build_work_list(wavefront_context *context) {
+    const block_mapping *mapping = &context->mapping;
+    int total_row_blocks = mapping->total_row_blocks;
+    int total_col_blocks = mapping->total_col_blocks;
+    int rank = context->current_rank;
+    long total_blocks = (long)total_row_blocks * total_col_blocks;
+
+    // Count the owned blocks first, no mapping bounds them tightly in closed form
+    long owned = 0;
+    for (int row = 0; row < total_row_blocks; row++) {
+        for (int col = 0; col < total_col_blocks; col++) {
+            if (block_owner(mapping, row, col) == rank) {
+                owned++;
+            }
+        }
+    }
+    context->work_list = (block_index *)malloc((owned + 1) * sizeof(block_index));
+    if (context->work_list == NULL) {
+        printf("Error allocating memory for a work list of %ld blocks.\n", owned);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    context->work_count = 0;
+    for (int row = 0; row < total_row_blocks; row++) {
+        for (int col = 0; col < total_col_blocks; col++) {
+            if (block_owner(mapping, row, col) == rank) {
+                block_index block = {row, col};
+                context->work_list[context->work_count++] = block;
+            }
         }
     }
-    sequence[character_index] = '\0';
-    fclose(file_pointer);
 
-    return sequence;
+    qsort(context->work_list, context->work_count, sizeof(block_index),
+          compare_block_dependency_order);
+
+    // Slot lookup for owned blocks
+    context->block_slots = (int *)malloc((total_blocks + 1) * sizeof(int));
+    if (context->block_slots == NULL) {
+        printf("Error allocating memory for the slots of %ld blocks.\n", total_blocks);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    for (long k = 0; k < total_blocks; k++) {
+        context->block_slots[k] = -1;
+    }
+    for (int k = 0; k < context->work_count; k++) {
+        block_index block = context->work_list[k];
+        context->block_slots[(long)block.row * total_col_blocks + block.col] = k;
+    }
+    context->local_storage = allocate_local_blocks(
+        context->work_count, (size_t)(context->tile_height + 1) * (context->tile_width + 1));
+    context->local_blocks = (matrix_element_type *)context->local_storage.data;
 }
 
 // ========================================
@@ -149,353 +368,1374 @@ char *read_sequence_from_file(char *filename) {
 // ========================================
 
 /**
- * Computes LCS for a specific block in the matrix using dynamic programming
- * @param matrix The LCS matrix
- * @param sequence_a First sequence
- * @param sequence_b Second sequence
+ * Computes LCS for a specific block using dynamic programming
+ * @param context Wavefront context
+ * @param block Local storage of the block, halo already received
  * @param block_row_index Row index of the block
  * @param block_col_index Column index of the block
- * @param sequence_a_length Length of sequence A
- * @param sequence_b_length Length of sequence B
  */
-void compute_lcs_block(matrix_element_type **matrix, char *sequence_a, char *sequence_b,
-                       int block_row_index, int block_col_index, int sequence_a_length,
-                       int sequence_b_length) {
-    // Calculate block boundaries
-    int row_start = block_row_index * BLOCK_SIZE + 1;
-    int row_end = min((block_row_index + 1) * BLOCK_SIZE, sequence_b_length);
-    int col_start = block_col_index * BLOCK_SIZE + 1;
-    int col_end = min((block_col_index + 1) * BLOCK_SIZE, sequence_a_length);
+void compute_lcs_block(const wavefront_context *context, matrix_element_type *block,
+                       int block_row_index, int block_col_index) {
+    int rows = block_height(context, block_row_index);
+    int cols = block_width(context, block_col_index);
+
+    // First character of A and of B the block covers
+    const encoded_sequences *sequences = context->sequences;
+    size_t col_start = (size_t)block_col_index * context->tile_width;
+    size_t row_start = (size_t)block_row_index * context->tile_height;
+    int width = context->tile_width;
 
     // Apply LCS dynamic programming algorithm to the block
-    for (int i = row_start; i <= row_end; i++) {
-        for (int j = col_start; j <= col_end; j++) {
-            if (sequence_a[j - 1] == sequence_b[i - 1]) {
-                // Characters match: take diagonal value + 1
-                matrix[i][j] = matrix[i - 1][j - 1] + 1;
+    for (int i = 1; i <= rows; i++) {
+        // Profile row of the character of B, bit j - 1 of a window is set where A matches it
+        unsigned code = seq_packed_code(sequences->packed_b, sequences->symbol_bits,
+                                        row_start + i - 1);
+        const uint64_t *match = sequences->profile_a + code * sequences->profile_words;
+        for (int first = 1; first <= cols; first += 64) {
+            uint64_t window = seq_profile_window(match, col_start + first - 1);
+            int last = min(cols, first + 63);
+            for (int j = first; j <= last; j++, window >>= 1) {
+                if (window & 1) {
+                    // Characters match: take diagonal value + 1
+                    BLOCK_ELEMENT(block, width, i, j) =
+                        BLOCK_ELEMENT(block, width, i - 1, j - 1) + 1;
+                } else {
+                    // Characters don't match: take maximum of left and top
+                    BLOCK_ELEMENT(block, width, i, j) = max(BLOCK_ELEMENT(block, width, i - 1, j),
+                                                            BLOCK_ELEMENT(block, width, i, j - 1));
+                }
+            }
+        }
+    }
+}
+
+// ========================================
+// CHECKPOINT FUNCTIONS
+// ========================================
+
+/**
+ * Checkpoint log of a rank, enabled with -c. Every rank appends to its own
+ * file, prefix.rank, a record each time its work list crosses a multiple of
+ * interval block antidiagonals, and one when it is done. A record for
+ * boundary d holds the bottom row and right column of the owned blocks on
+ * antidiagonal d - 1, which is all the blocks from d on ever read of the
+ * blocks before them. Records go out through POSIX AIO from two buffers, so
+ * the wavefront only waits when the write from two records ago is still
+ * running. Ranks record at their own pace and agree on a boundary on restart
+ */
+typedef struct {
+    int fd;               // -1 when checkpoints are disabled
+    int interval;         // Block antidiagonals between records
+    int total_diagonals;  // Block antidiagonals of the matrix, the final boundary
+    int next_diagonal;    // Next boundary to record, past the final one when done
+    int resume_diagonal;  // Boundary the run resumed from, 0 for a fresh start
+    off_t end;            // End of the last record
+    struct aiocb request[2];
+    char *buffer[2];
+    size_t capacity[2];
+    int next_buffer;
+} checkpoint_log;
+
+// Start of a record, followed by payload_bytes of block borders
+typedef struct {
+    uint64_t magic;
+    uint64_t diagonal;
+    uint64_t payload_bytes;
+} checkpoint_record;
+
+/**
+ * Antidiagonal of a block
+ * @param block Block position
+ * @return Row plus column index
+ */
+int block_diagonal(block_index block) {
+    return block.row + block.col;
+}
+
+/**
+ * Bytes of the borders a record keeps of the owned blocks on one antidiagonal
+ * @param context Wavefront context
+ * @param diagonal Antidiagonal of the blocks
+ * @return Bottom rows with their halo element plus right columns
+ */
+size_t checkpoint_payload_bytes(const wavefront_context *context, int diagonal) {
+    size_t elements = 0;
+    for (int k = 0; k < context->work_count; k++) {
+        block_index block = context->work_list[k];
+        if (block_diagonal(block) == diagonal) {
+            elements += block_width(context, block.col) + 1 + block_height(context, block.row);
+        }
+    }
+    return elements * sizeof(matrix_element_type);
+}
+
+/**
+ * Copies the borders of the owned blocks on one antidiagonal to or from a payload
+ * @param context Wavefront context
+ * @param diagonal Antidiagonal of the blocks
+ * @param payload Record payload
+ * @param restore 1 to write the payload into the blocks, 0 to fill it from them
+ */
+void checkpoint_copy_borders(const wavefront_context *context, int diagonal,
+                             matrix_element_type *payload, int restore) {
+    int width = context->tile_width;
+    for (int k = 0; k < context->work_count; k++) {
+        block_index index = context->work_list[k];
+        if (block_diagonal(index) != diagonal) {
+            continue;
+        }
+        matrix_element_type *block = get_local_block(context, index.row, index.col);
+        int rows = block_height(context, index.row);
+        int cols = block_width(context, index.col);
+
+        // Bottom row from the halo column on, then the right column
+        matrix_element_type *bottom = &BLOCK_ELEMENT(block, width, rows, 0);
+        if (restore) {
+            memcpy(bottom, payload, (cols + 1) * sizeof(matrix_element_type));
+        } else {
+            memcpy(payload, bottom, (cols + 1) * sizeof(matrix_element_type));
+        }
+        payload += cols + 1;
+        for (int i = 1; i <= rows; i++) {
+            if (restore) {
+                BLOCK_ELEMENT(block, width, i, cols) = *payload++;
             } else {
-                // Characters don't match: take maximum of left and top
-                matrix[i][j] = max(matrix[i - 1][j], matrix[i][j - 1]);
+                *payload++ = BLOCK_ELEMENT(block, width, i, cols);
             }
         }
     }
 }
 
+/**
+ * Waits for the write issued from a buffer, if any
+ * @param log Checkpoint log
+ * @param k Buffer index
+ */
+void checkpoint_wait(checkpoint_log *log, int k) {
+    if (log->request[k].aio_buf == NULL) {
+        return;
+    }
+    const struct aiocb *pending[1] = {&log->request[k]};
+    while (aio_error(&log->request[k]) == EINPROGRESS) {
+        aio_suspend(pending, 1, NULL);
+    }
+    if (aio_return(&log->request[k]) != (ssize_t)log->request[k].aio_nbytes) {
+        fprintf(stderr, "Warning: writing a checkpoint record failed\n");
+    }
+    log->request[k].aio_buf = NULL;
+}
+
+/**
+ * Appends the record of one boundary, every owned block before it is done
+ * @param log Checkpoint log
+ * @param context Wavefront context
+ * @param diagonal Boundary to record
+ */
+void checkpoint_append(checkpoint_log *log, const wavefront_context *context, int diagonal) {
+    int k = log->next_buffer;
+    checkpoint_wait(log, k);
+
+    checkpoint_record record = {CHECKPOINT_RECORD_MAGIC, diagonal,
+                                checkpoint_payload_bytes(context, diagonal - 1)};
+    size_t bytes = sizeof(record) + record.payload_bytes;
+    if (bytes > log->capacity[k]) {
+        free(log->buffer[k]);
+        log->buffer[k] = (char *)malloc(bytes);
+        log->capacity[k] = bytes;
+        if (!log->buffer[k]) {
+            printf("Error allocating memory for checkpoint records.\n");
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+    }
+    memcpy(log->buffer[k], &record, sizeof(record));
+    checkpoint_copy_borders(context, diagonal - 1,
+                            (matrix_element_type *)(log->buffer[k] + sizeof(record)), 0);
+
+    memset(&log->request[k], 0, sizeof(log->request[k]));
+    log->request[k].aio_fildes = log->fd;
+    log->request[k].aio_buf = log->buffer[k];
+    log->request[k].aio_nbytes = bytes;
+    log->request[k].aio_offset = log->end;
+    if (aio_write(&log->request[k]) != 0) {
+        // Fall back to a blocking write
+        if (pwrite(log->fd, log->buffer[k], bytes, log->end) != (ssize_t)bytes) {
+            fprintf(stderr, "Warning: writing a checkpoint record failed\n");
+        }
+        log->request[k].aio_buf = NULL;
+    }
+    log->end += bytes;
+    log->next_buffer ^= 1;
+}
+
+/**
+ * Boundary following another: the next multiple of the interval, capped at
+ * the final boundary, and past the final boundary once that one is recorded
+ * @param log Checkpoint log
+ * @param diagonal Boundary recorded or resumed from
+ * @return Next boundary to record
+ */
+int checkpoint_following(const checkpoint_log *log, int diagonal) {
+    if (diagonal >= log->total_diagonals) {
+        return log->total_diagonals + 1;
+    }
+    return min((diagonal / log->interval + 1) * log->interval, log->total_diagonals);
+}
+
+/**
+ * Records every boundary up to a diagonal the work list has reached
+ * @param log Checkpoint log, NULL or disabled for none
+ * @param context Wavefront context
+ * @param diagonal Antidiagonal of the next owned block, or the final boundary when done
+ */
+void checkpoint_reached(checkpoint_log *log, const wavefront_context *context, int diagonal) {
+    while (log && log->fd >= 0 && log->next_diagonal <= diagonal) {
+        checkpoint_append(log, context, log->next_diagonal);
+        log->next_diagonal = checkpoint_following(log, log->next_diagonal);
+    }
+}
+
+/**
+ * Walks the records of a log file: finds the latest complete one and the
+ * position of the one for a given boundary
+ * @param fd Log file
+ * @param target Boundary to look for
+ * @param context Wavefront context, to check payload sizes
+ * @param target_offset Start of the target record, -1 if missing
+ * @return Latest boundary with a complete record, 0 if none
+ */
+int checkpoint_scan(int fd, int target, const wavefront_context *context, off_t *target_offset) {
+    off_t file_size = lseek(fd, 0, SEEK_END);
+    off_t offset = sizeof(seq_checkpoint_header);
+    checkpoint_record record;
+    int latest = 0;
+
+    *target_offset = -1;
+    while (offset + (off_t)sizeof(record) <= file_size &&
+           pread(fd, &record, sizeof(record), offset) == sizeof(record) &&
+           record.magic == CHECKPOINT_RECORD_MAGIC &&
+           offset + (off_t)(sizeof(record) + record.payload_bytes) <= file_size &&
+           record.payload_bytes == checkpoint_payload_bytes(context, (int)record.diagonal - 1)) {
+        latest = record.diagonal;
+        if ((int)record.diagonal == target) {
+            *target_offset = offset;
+        }
+        offset += sizeof(record) + record.payload_bytes;
+    }
+    return latest;
+}
+
+/**
+ * Opens the log of this rank and resumes from it when possible. The ranks
+ * take the earliest of their latest boundaries, every rank has recorded it
+ * on the way to its own latest one. Collective
+ * @param log Checkpoint log to initialize
+ * @param context Wavefront context, blocks of the resumed boundary are restored into it
+ * @param prefix Log files are prefix.rank, NULL to disable checkpoints
+ * @param interval Block antidiagonals between records
+ * @param header Header of this run, the log is only resumed when it matches
+ */
+void checkpoint_open(checkpoint_log *log, wavefront_context *context, const char *prefix,
+                     int interval, const seq_checkpoint_header *header) {
+    memset(log, 0, sizeof(*log));
+    log->fd = -1;
+    if (prefix == NULL) {
+        return;
+    }
+    log->interval = interval;
+    log->total_diagonals =
+        context->mapping.total_row_blocks + context->mapping.total_col_blocks - 1;
+
+    char path[4096];
+    snprintf(path, sizeof(path), "%s.%d", prefix, context->current_rank);
+    log->fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (log->fd < 0) {
+        printf("Rank %d: error opening checkpoint %s.\n", context->current_rank, path);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    // Latest boundary of this rank, none if the log belongs to another run
+    seq_checkpoint_header saved;
+    off_t offset;
+    int latest = 0;
+    if (pread(log->fd, &saved, sizeof(saved), 0) == sizeof(saved)) {
+        if (seq_checkpoint_matches(&saved, header)) {
+            latest = checkpoint_scan(log->fd, -1, context, &offset);
+        } else {
+            fprintf(stderr, "Warning: %s belongs to another run, starting from scratch\n", path);
+        }
+    }
+    int resume = latest;
+    MPI_Allreduce(&latest, &resume, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+
+    // Every rank needs a record of that exact boundary
+    int found = 0;
+    if (resume > 0) {
+        checkpoint_scan(log->fd, resume, context, &offset);
+        found = offset >= 0;
+    }
+    MPI_Allreduce(MPI_IN_PLACE, &found, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+
+    if (resume > 0 && found) {
+        checkpoint_record record;
+        pread(log->fd, &record, sizeof(record), offset);
+        matrix_element_type *payload = (matrix_element_type *)malloc(record.payload_bytes + 1);
+        if (!payload || pread(log->fd, payload, record.payload_bytes, offset + sizeof(record)) !=
+                            (ssize_t)record.payload_bytes) {
+            printf("Rank %d: error reading checkpoint %s.\n", context->current_rank, path);
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        checkpoint_copy_borders(context, resume - 1, payload, 1);
+        free(payload);
+
+        // Later records are appended again from here
+        log->end = offset + sizeof(record) + record.payload_bytes;
+        log->resume_diagonal = resume;
+    } else {
+        log->end = sizeof(*header);
+        if (pwrite(log->fd, header, sizeof(*header), 0) != sizeof(*header)) {
+            printf("Rank %d: error writing checkpoint %s.\n", context->current_rank, path);
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+    }
+    if (ftruncate(log->fd, log->end) != 0) {
+        fprintf(stderr, "Warning: could not truncate %s\n", path);
+    }
+    log->next_diagonal = checkpoint_following(log, log->resume_diagonal);
+}
+
+/**
+ * Waits for the outstanding records and closes the log
+ * @param log Checkpoint log
+ */
+void checkpoint_close(checkpoint_log *log) {
+    if (log->fd < 0) {
+        return;
+    }
+    checkpoint_wait(log, 0);
+    checkpoint_wait(log, 1);
+    fsync(log->fd);
+    close(log->fd);
+    free(log->buffer[0]);
+    free(log->buffer[1]);
+}
+
 // ========================================
 // MPI COMMUNICATION FUNCTIONS
 // ========================================
 
 /**
- * Receives horizontal dependency data from the block above
- * @param matrix The LCS matrix
+ * Persistent requests of one direction, each with its pack buffer. The slots
+ * grow when all are in use, so neither side ever blocks to free one: halo
+ * messages of large tiles go by rendezvous and only complete once the peer
+ * posts the receive, which it may do only after its own sends got through.
+ * Sends take any slot MPI_Test finds done; receives form a queue, waited on
+ * in the order they were posted
+ */
+typedef struct {
+    matrix_element_type **buffer;
+    MPI_Request *request;
+    int count;    // Slots
+    int next;     // Sends: slot to try first. Receives: oldest posted one
+    int pending;  // Receives posted and not waited on yet
+    int elements, peer, tag, is_send;
+} halo_channel;
+
+/**
+ * Persistent halo exchange of a rank. The supported mappings give every rank
+ * at most one remote peer per direction, so the requests are created once;
+ * neighbours owned by the same rank are copied locally and never hit MPI.
+ * The receives of the next block are posted while the current block is computed
+ */
+typedef struct {
+    halo_channel recv_row, recv_col, send_row, send_col;
+    int posted;  // Work list entries before this one have their receives posted
+} halo_exchange;
+
+/**
+ * Records the remote peer of one direction, aborting if the mapping needs two
+ * @param peer Peer found so far, MPI_PROC_NULL if none
+ * @param owner Owner of the neighbour block
+ * @param current_rank Current MPI rank
+ */
+void set_halo_peer(int *peer, int owner, int current_rank) {
+    if (owner == current_rank) {
+        return;
+    }
+    if (*peer != MPI_PROC_NULL && *peer != owner) {
+        printf("Rank %d: block mapping needs more than one peer per direction.\n", current_rank);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    *peer = owner;
+}
+
+/**
+ * Grows a channel to count slots. The slots are rotated so that next comes
+ * first, which keeps the posting order of a receive queue, and new ones are
+ * added behind them
+ * @param channel Channel to grow
+ * @param count New number of slots
+ */
+void halo_channel_grow(halo_channel *channel, int count) {
+    matrix_element_type **buffer =
+        (matrix_element_type **)malloc(count * sizeof(matrix_element_type *));
+    MPI_Request *request = (MPI_Request *)malloc(count * sizeof(MPI_Request));
+    if (!buffer || !request) {
+        printf("Error allocating memory for halo buffers.\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    for (int k = 0; k < channel->count; k++) {
+        int from = (channel->next + k) % channel->count;
+        buffer[k] = channel->buffer[from];
+        request[k] = channel->request[from];
+    }
+
+    for (int k = channel->count; k < count; k++) {
+        buffer[k] = (matrix_element_type *)malloc(channel->elements * sizeof(matrix_element_type));
+        if (!buffer[k]) {
+            printf("Error allocating memory for halo buffers.\n");
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        if (channel->is_send) {
+            MPI_Send_init(buffer[k], channel->elements, MPI_UNSIGNED_SHORT, channel->peer,
+                          channel->tag, MPI_COMM_WORLD, &request[k]);
+        } else {
+            MPI_Recv_init(buffer[k], channel->elements, MPI_UNSIGNED_SHORT, channel->peer,
+                          channel->tag, MPI_COMM_WORLD, &request[k]);
+        }
+    }
+    free(channel->buffer);
+    free(channel->request);
+    channel->buffer = buffer;
+    channel->request = request;
+    channel->count = count;
+    channel->next = 0;
+}
+
+/**
+ * Creates a channel with two slots
+ * @param channel Channel to initialize
+ * @param elements Elements per message
+ * @param peer Remote rank, MPI_PROC_NULL if none
+ * @param tag Message tag
+ * @param is_send Whether the channel sends or receives
+ */
+void halo_channel_init(halo_channel *channel, int elements, int peer, int tag, int is_send) {
+    memset(channel, 0, sizeof(*channel));
+    channel->elements = elements;
+    channel->peer = peer;
+    channel->tag = tag;
+    channel->is_send = is_send;
+    halo_channel_grow(channel, 2);
+}
+
+/**
+ * Finds a send slot whose previous send is done, without blocking
+ * @param channel Send channel
+ * @return Index of a free slot, the channel is grown if none is
+ */
+int halo_send_acquire(halo_channel *channel) {
+    for (int tried = 0; tried < channel->count; tried++) {
+        int k = (channel->next + tried) % channel->count;
+        int done;
+        // Inactive persistent requests test as done
+        MPI_Test(&channel->request[k], &done, MPI_STATUS_IGNORE);
+        if (done) {
+            channel->next = (k + 1) % channel->count;
+            return k;
+        }
+    }
+    int k = channel->count;
+    halo_channel_grow(channel, 2 * channel->count);
+    channel->next = k + 1;
+    return k;
+}
+
+/**
+ * Posts one more receive at the back of the queue
+ * @param channel Receive channel
+ */
+void halo_recv_post(halo_channel *channel) {
+    if (channel->pending == channel->count) {
+        halo_channel_grow(channel, 2 * channel->count);
+    }
+    MPI_Start(&channel->request[(channel->next + channel->pending) % channel->count]);
+    channel->pending++;
+}
+
+/**
+ * Completes the oldest posted receive
+ * @param channel Receive channel
+ * @return Slot holding the message, valid until the next post
+ */
+int halo_recv_wait(halo_channel *channel) {
+    int k = channel->next;
+    MPI_Wait(&channel->request[k], MPI_STATUS_IGNORE);
+    channel->next = (k + 1) % channel->count;
+    channel->pending--;
+    return k;
+}
+
+/**
+ * Waits for the requests in flight and releases the channel
+ * @param channel Channel to release
+ */
+void halo_channel_free(halo_channel *channel) {
+    MPI_Waitall(channel->count, channel->request, MPI_STATUSES_IGNORE);
+    for (int k = 0; k < channel->count; k++) {
+        MPI_Request_free(&channel->request[k]);
+        free(channel->buffer[k]);
+    }
+    free(channel->buffer);
+    free(channel->request);
+}
+
+/**
+ * Allocates the pack buffers and creates the persistent requests
+ * @param halo Exchange state to initialize
+ * @param context Wavefront context with the work list built
+ */
+void halo_exchange_init(halo_exchange *halo, const wavefront_context *context) {
+    const block_mapping *mapping = &context->mapping;
+    int up_rank = MPI_PROC_NULL, down_rank = MPI_PROC_NULL;
+    int left_rank = MPI_PROC_NULL, right_rank = MPI_PROC_NULL;
+
+    // Find the remote neighbours of the owned blocks
+    for (int k = 0; k < context->work_count; k++) {
+        block_index block = context->work_list[k];
+        if (block.row > 0) {
+            set_halo_peer(&up_rank, block_owner(mapping, block.row - 1, block.col),
+                          context->current_rank);
+        }
+        if (block.row < mapping->total_row_blocks - 1) {
+            set_halo_peer(&down_rank, block_owner(mapping, block.row + 1, block.col),
+                          context->current_rank);
+        }
+        if (block.col > 0) {
+            set_halo_peer(&left_rank, block_owner(mapping, block.row, block.col - 1),
+                          context->current_rank);
+        }
+        if (block.col < mapping->total_col_blocks - 1) {
+            set_halo_peer(&right_rank, block_owner(mapping, block.row, block.col + 1),
+                          context->current_rank);
+        }
+    }
+
+    // Rows carry the diagonal element in front, columns don't
+    int row_elements = context->tile_width + 1;
+    int col_elements = context->tile_height;
+
+    // Full-size messages: edge blocks send a few unused elements so the
+    // counts stay fixed, the receiver only reads what its block needs
+    halo_channel_init(&halo->recv_row, row_elements, up_rank, HORIZONTAL_TAG, 0);
+    halo_channel_init(&halo->recv_col, col_elements, left_rank, VERTICAL_TAG, 0);
+    halo_channel_init(&halo->send_row, row_elements, down_rank, HORIZONTAL_TAG, 1);
+    halo_channel_init(&halo->send_col, col_elements, right_rank, VERTICAL_TAG, 1);
+    halo->posted = 0;
+}
+
+/**
+ * Waits for the outstanding sends and releases the persistent requests
+ * @param halo Exchange state to release
+ */
+void halo_exchange_free(halo_exchange *halo) {
+    halo_channel_free(&halo->send_row);
+    halo_channel_free(&halo->send_col);
+    halo_channel_free(&halo->recv_row);
+    halo_channel_free(&halo->recv_col);
+}
+
+/**
+ * Posts the receives that blocks of the work list need from remote neighbours,
+ * ahead of the blocks being processed. Posting follows the work list, the
+ * order the peers send in, so messages match their block
+ * @param halo Exchange state
+ * @param context Wavefront context
+ * @param last_index Last work list entry to post for
+ */
+void post_receives_through(halo_exchange *halo, const wavefront_context *context,
+                           int last_index) {
+    const block_mapping *mapping = &context->mapping;
+    for (; halo->posted <= last_index && halo->posted < context->work_count; halo->posted++) {
+        block_index block = context->work_list[halo->posted];
+        if (block.row > 0 &&
+            block_owner(mapping, block.row - 1, block.col) != context->current_rank) {
+            halo_recv_post(&halo->recv_row);
+        }
+        if (block.col > 0 &&
+            block_owner(mapping, block.row, block.col - 1) != context->current_rank) {
+            halo_recv_post(&halo->recv_col);
+        }
+    }
+}
+
+/**
+ * Fills the halo row from the block above, locally or from its pending receive
+ * @param halo Exchange state
+ * @param context Wavefront context
+ * @param block Local storage of the current block
  * @param block_row_index Row index of current block
  * @param block_col_index Column index of current block
- * @param sequence_a_length Length of sequence A
- * @param total_col_blocks Total number of column blocks
- * @param world_size Number of MPI processes
  */
-void receive_horizontal_dependency(matrix_element_type **matrix, int block_row_index,
-                                   int block_col_index, int sequence_a_length, int total_col_blocks,
-                                   int world_size) {
+void receive_horizontal_dependency(halo_exchange *halo, const wavefront_context *context,
+                                   matrix_element_type *block, int block_row_index,
+                                   int block_col_index) {
     if (block_row_index > 0) {
-        int source_rank = ((block_row_index - 1) * total_col_blocks + block_col_index) % world_size;
-        int row_to_receive =
-            block_row_index * BLOCK_SIZE;  // halo cell -> row to receive form other process
-        int col_start = block_col_index * BLOCK_SIZE + 1;
-        int col_end = min((block_col_index + 1) * BLOCK_SIZE, sequence_a_length);
-        int elements_count = col_end - col_start + 1;
+        // +1 for the diagonal element, which lands in the halo corner
+        size_t bytes = (block_width(context, block_col_index) + 1) * sizeof(matrix_element_type);
 
-        MPI_Recv(&matrix[row_to_receive][col_start - 1], elements_count + 1, MPI_UNSIGNED_SHORT,
-                 source_rank, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        if (block_owner(&context->mapping, block_row_index - 1, block_col_index) ==
+            context->current_rank) {
+            matrix_element_type *above =
+                get_local_block(context, block_row_index - 1, block_col_index);
+            memcpy(&BLOCK_ELEMENT(block, context->tile_width, 0, 0),
+                   &BLOCK_ELEMENT(above, context->tile_width, context->tile_height, 0), bytes);
+        } else {
+            int k = halo_recv_wait(&halo->recv_row);
+            memcpy(&BLOCK_ELEMENT(block, context->tile_width, 0, 0), halo->recv_row.buffer[k],
+                   bytes);
+        }
     }
 }
 
 /**
- * Receives vertical dependency data from the block to the left
- * @param matrix The LCS matrix
+ * Fills the halo column from the block to the left, locally or from its pending receive
+ * @param halo Exchange state
+ * @param context Wavefront context
+ * @param block Local storage of the current block
  * @param block_row_index Row index of current block
  * @param block_col_index Column index of current block
- * @param sequence_b_length Length of sequence B
- * @param total_col_blocks Total number of column blocks
- * @param world_size Number of MPI processes
  */
-void receive_vertical_dependency(matrix_element_type **matrix, int block_row_index,
-                                 int block_col_index, int sequence_b_length, int total_col_blocks,
-                                 int world_size) {
+void receive_vertical_dependency(halo_exchange *halo, const wavefront_context *context,
+                                 matrix_element_type *block, int block_row_index,
+                                 int block_col_index) {
     if (block_col_index > 0) {
-        int source_rank = (block_row_index * total_col_blocks + (block_col_index - 1)) % world_size;
-        int row_start = block_row_index * BLOCK_SIZE + 1;
-        int row_end = min((block_row_index + 1) * BLOCK_SIZE, sequence_b_length);
-        int col_to_receive = block_col_index * BLOCK_SIZE;
-        int elements_count = row_end - row_start + 1;
+        int elements_count = block_height(context, block_row_index);
 
-        matrix_element_type *temp_column =
-            (matrix_element_type *)malloc(elements_count * sizeof(matrix_element_type));
-        MPI_Recv(temp_column, elements_count, MPI_UNSIGNED_SHORT, source_rank, 1, MPI_COMM_WORLD,
-                 MPI_STATUS_IGNORE);
-
-        // Copy received data to matrix
-        for (int k = 0; k < elements_count; ++k) {
-            matrix[row_start + k][col_to_receive] = temp_column[k];
+        if (block_owner(&context->mapping, block_row_index, block_col_index - 1) ==
+            context->current_rank) {
+            matrix_element_type *left =
+                get_local_block(context, block_row_index, block_col_index - 1);
+            for (int i = 1; i <= elements_count; ++i) {
+                BLOCK_ELEMENT(block, context->tile_width, i, 0) =
+                    BLOCK_ELEMENT(left, context->tile_width, i, context->tile_width);
+            }
+        } else {
+            int k = halo_recv_wait(&halo->recv_col);
+            for (int i = 0; i < elements_count; ++i) {
+                BLOCK_ELEMENT(block, context->tile_width, i + 1, 0) = halo->recv_col.buffer[k][i];
+            }
         }
-        free(temp_column);
     }
 }
 
 /**
- * Sends horizontal data to the block below
- * @param matrix The LCS matrix
+ * Starts sending the bottom row of a block to the block below, if remote
+ * @param halo Exchange state
+ * @param context Wavefront context
+ * @param block Local storage of the current block
  * @param block_row_index Row index of current block
  * @param block_col_index Column index of current block
- * @param sequence_a_length Length of sequence A
- * @param total_row_blocks Total number of row blocks
- * @param total_col_blocks Total number of column blocks
- * @param world_size Number of MPI processes
  */
-void send_horizontal_data(matrix_element_type **matrix, int block_row_index, int block_col_index,
-                          int sequence_a_length, int total_row_blocks, int total_col_blocks,
-                          int world_size) {
-    if (block_row_index < total_row_blocks - 1) {
-        int dest_rank = ((block_row_index + 1) * total_col_blocks + block_col_index) % world_size;
-        int row_to_send = (block_row_index + 1) * BLOCK_SIZE;
-        int col_start = block_col_index * BLOCK_SIZE + 1;
-        int col_end = min((block_col_index + 1) * BLOCK_SIZE, sequence_a_length);
-        int elements_count = col_end - col_start + 1;
+void send_horizontal_data(halo_exchange *halo, const wavefront_context *context,
+                          matrix_element_type *block, int block_row_index, int block_col_index) {
+    if (block_row_index < context->mapping.total_row_blocks - 1 &&
+        block_owner(&context->mapping, block_row_index + 1, block_col_index) !=
+            context->current_rank) {
+        int last_row = block_height(context, block_row_index);
+        int elements_count = block_width(context, block_col_index);
+        int k = halo_send_acquire(&halo->send_row);
 
-        // -1 to add the diagonal element
-        MPI_Send(&matrix[row_to_send][col_start - 1], elements_count + 1, MPI_UNSIGNED_SHORT,
-                 dest_rank, 0, MPI_COMM_WORLD);
+        // Starts at the halo column to add the diagonal element
+        memcpy(halo->send_row.buffer[k], &BLOCK_ELEMENT(block, context->tile_width, last_row, 0),
+               (elements_count + 1) * sizeof(matrix_element_type));
+        MPI_Start(&halo->send_row.request[k]);
     }
 }
 
 /**
- * Sends vertical data to the block to the right
- * @param matrix The LCS matrix
+ * Starts sending the right column of a block to the block to the right, if remote
+ * @param halo Exchange state
+ * @param context Wavefront context
+ * @param block Local storage of the current block
  * @param block_row_index Row index of current block
  * @param block_col_index Column index of current block
- * @param sequence_b_length Length of sequence B
- * @param total_col_blocks Total number of column blocks
- * @param world_size Number of MPI processes
  */
-void send_vertical_data(matrix_element_type **matrix, int block_row_index, int block_col_index,
-                        int sequence_b_length, int total_col_blocks, int world_size) {
-    if (block_col_index < total_col_blocks - 1) {
-        int dest_rank = (block_row_index * total_col_blocks + (block_col_index + 1)) % world_size;
-        int row_start = block_row_index * BLOCK_SIZE + 1;
-        int row_end = min((block_row_index + 1) * BLOCK_SIZE, sequence_b_length);
-        int col_to_send = (block_col_index + 1) * BLOCK_SIZE;
-        int elements_count = row_end - row_start + 1;
+void send_vertical_data(halo_exchange *halo, const wavefront_context *context,
+                        matrix_element_type *block, int block_row_index, int block_col_index) {
+    if (block_col_index < context->mapping.total_col_blocks - 1 &&
+        block_owner(&context->mapping, block_row_index, block_col_index + 1) !=
+            context->current_rank) {
+        int last_col = block_width(context, block_col_index);
+        int elements_count = block_height(context, block_row_index);
+        int k = halo_send_acquire(&halo->send_col);
+
+        for (int i = 0; i < elements_count; ++i) {
+            halo->send_col.buffer[k][i] =
+                BLOCK_ELEMENT(block, context->tile_width, i + 1, last_col);
+        }
+        MPI_Start(&halo->send_col.request[k]);
+    }
+}
 
-        matrix_element_type *temp_column =
-            (matrix_element_type *)malloc(elements_count * sizeof(matrix_element_type));
+/**
+ * Processes the k-th block of the work list. Its receives were posted earlier;
+ * the receives of the next local block are posted before computing, so that
+ * transfer overlaps compute_lcs_block
+ * @param halo Exchange state
+ * @param context Wavefront context
+ * @param work_index Position of the block in the work list
+ */
+void process_wavefront_block(halo_exchange *halo, const wavefront_context *context,
+                             int work_index) {
+    block_index current = context->work_list[work_index];
+    matrix_element_type *block = get_local_block(context, current.row, current.col);
+
+    // Step 1: Post the receives of the next block, then complete our own
+    post_receives_through(halo, context, work_index + 1);
+#ifdef LCS_TRACE
+    int diagonal = block_diagonal(current);
+    uint64_t trace_start = seq_trace_now();
+#endif
+    receive_horizontal_dependency(halo, context, block, current.row, current.col);
+    receive_vertical_dependency(halo, context, block, current.row, current.col);
+#ifdef LCS_TRACE
+    if (trace_buffer) {
+        seq_trace_record(trace_buffer, SEQ_TRACE_RECV, trace_start, diagonal);
+        trace_start = seq_trace_now();
+    }
+#endif
 
-        // Copy data to temporary column
-        for (int k = 0; k < elements_count; ++k) {
-            temp_column[k] = matrix[row_start + k][col_to_send];
+    // Step 2: Compute the LCS for this block
+#ifdef LCS_PERF
+    if (block_counters) {
+        seq_perf_enable(block_counters);
+    }
+#endif
+    compute_lcs_block(context, block, current.row, current.col);
+#ifdef LCS_PERF
+    if (block_counters) {
+        seq_perf_disable(block_counters);
+    }
+#endif
+#ifdef LCS_TRACE
+    if (trace_buffer) {
+        seq_trace_record(trace_buffer, SEQ_TRACE_COMPUTE, trace_start, diagonal);
+        trace_start = seq_trace_now();
+    }
+#endif
+
+    // Step 3: Start sending computed data to dependent blocks
+    send_horizontal_data(halo, context, block, current.row, current.col);
+    send_vertical_data(halo, context, block, current.row, current.col);
+#ifdef LCS_TRACE
+    if (trace_buffer) {
+        seq_trace_record(trace_buffer, SEQ_TRACE_SEND, trace_start, diagonal);
+    }
+#endif
+}
+
+/**
+ * Runs this rank's part of the wavefront: owned blocks in dependency order.
+ * After a restart the blocks before the resumed boundary are skipped, those
+ * right before it send their restored borders again, as if just computed
+ * @param context Wavefront context with the work list built
+ * @param log Checkpoint log, NULL for none
+ */
+void run_wavefront(const wavefront_context *context, checkpoint_log *log) {
+    halo_exchange halo;
+    halo_exchange_init(&halo, context);
+
+    int first = 0;
+    int resume = log ? log->resume_diagonal : 0;
+    while (first < context->work_count && block_diagonal(context->work_list[first]) < resume) {
+        first++;
+    }
+
+    // The receives of the whole first diagonal go out before the resends,
+    // which the peers may need first to get to their own resends
+    int last = first;
+    while (last + 1 < context->work_count &&
+           block_diagonal(context->work_list[last + 1]) ==
+               block_diagonal(context->work_list[first])) {
+        last++;
+    }
+    halo.posted = first;
+    post_receives_through(&halo, context, last);
+    for (int k = 0; k < first; k++) {
+        block_index block = context->work_list[k];
+        if (block_diagonal(block) == resume - 1) {
+            matrix_element_type *storage = get_local_block(context, block.row, block.col);
+            send_horizontal_data(&halo, context, storage, block.row, block.col);
+            send_vertical_data(&halo, context, storage, block.row, block.col);
         }
+    }
 
-        MPI_Send(temp_column, elements_count, MPI_UNSIGNED_SHORT, dest_rank, 1, MPI_COMM_WORLD);
-        free(temp_column);
+    for (int k = first; k < context->work_count; k++) {
+        checkpoint_reached(log, context, block_diagonal(context->work_list[k]));
+        process_wavefront_block(&halo, context, k);
+    }
+    if (log) {
+        checkpoint_reached(log, context, log->total_diagonals);
     }
+    halo_exchange_free(&halo);
 }
 
+#ifdef LCS_TRACE
+// ========================================
+// TIMELINE TRACE FUNCTIONS
+// ========================================
+
 /**
- * Processes a single block in the wavefront algorithm
- * @param matrix The LCS matrix
- * @param sequence_a First sequence
- * @param sequence_b Second sequence
- * @param block_row_index Row index of the block
- * @param block_col_index Column index of the block
- * @param sequence_a_length Length of sequence A
- * @param sequence_b_length Length of sequence B
- * @param total_row_blocks Total number of row blocks
- * @param total_col_blocks Total number of column blocks
- * @param world_size Number of MPI processes
+ * Estimates the offset from this rank's clock to the root's. Each rank in turn
+ * probes the root TRACE_SYNC_ROUNDS times and keeps the probe with the
+ * fastest round trip, assuming the root read its clock halfway through it
+ * @param current_rank Rank of this process
+ * @param world_size Number of ranks
+ * @return Nanoseconds to add to a local time to get the root's time
  */
-void process_wavefront_block(matrix_element_type **matrix, char *sequence_a, char *sequence_b,
-                             int block_row_index, int block_col_index, int sequence_a_length,
-                             int sequence_b_length, int total_row_blocks, int total_col_blocks,
-                             int world_size) {
-    // Step 1: Receive dependencies from neighboring blocks
-    receive_horizontal_dependency(matrix, block_row_index, block_col_index, sequence_a_length,
-                                  total_col_blocks, world_size);
-    receive_vertical_dependency(matrix, block_row_index, block_col_index, sequence_b_length,
-                                total_col_blocks, world_size);
+int64_t trace_clock_offset(int current_rank, int world_size) {
+    int64_t offset = 0;
+    if (current_rank == 0) {
+        for (int rank = 1; rank < world_size; rank++) {
+            for (int round = 0; round < TRACE_SYNC_ROUNDS; round++) {
+                MPI_Recv(NULL, 0, MPI_BYTE, rank, TRACE_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+                uint64_t root_time = seq_trace_now();
+                MPI_Send(&root_time, 1, MPI_UINT64_T, rank, TRACE_TAG, MPI_COMM_WORLD);
+            }
+        }
+        return 0;
+    }
 
-    // Step 2: Compute the LCS for this block
-    compute_lcs_block(matrix, sequence_a, sequence_b, block_row_index, block_col_index,
-                      sequence_a_length, sequence_b_length);
+    uint64_t best_round_trip = UINT64_MAX;
+    for (int round = 0; round < TRACE_SYNC_ROUNDS; round++) {
+        uint64_t root_time;
+        uint64_t sent = seq_trace_now();
+        MPI_Send(NULL, 0, MPI_BYTE, 0, TRACE_TAG, MPI_COMM_WORLD);
+        MPI_Recv(&root_time, 1, MPI_UINT64_T, 0, TRACE_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        uint64_t received = seq_trace_now();
+        if (received - sent < best_round_trip) {
+            best_round_trip = received - sent;
+            offset = (int64_t)(root_time - (sent + (received - sent) / 2));
+        }
+    }
+    return offset;
+}
 
-    // Step 3: Send computed data to dependent blocks
-    send_horizontal_data(matrix, block_row_index, block_col_index, sequence_a_length,
-                         total_row_blocks, total_col_blocks, world_size);
-    send_vertical_data(matrix, block_row_index, block_col_index, sequence_b_length,
-                       total_col_blocks, world_size);
+/**
+ * Sends every rank's timeline to the root, which writes them as one trace
+ * with a row per rank, all on the root's clock
+ * @param buffer Events of this rank
+ * @param offset trace_clock_offset of this rank
+ * @param origin Root time shown as zero, only used at the root
+ * @param current_rank Rank of this process
+ * @param world_size Number of ranks
+ */
+void write_trace_at_root(const seq_trace_buffer *buffer, int64_t offset, uint64_t origin,
+                         int current_rank, int world_size) {
+    int64_t summary[2] = {(int64_t)buffer->count, offset};
+    if (current_rank != 0) {
+        MPI_Send(summary, 2, MPI_INT64_T, 0, TRACE_TAG, MPI_COMM_WORLD);
+        MPI_Send(buffer->events, buffer->count * sizeof(seq_trace_event), MPI_BYTE, 0, TRACE_TAG,
+                 MPI_COMM_WORLD);
+        return;
+    }
+
+    seq_trace_file file;
+    const char *path = seq_trace_path();
+    int writing = seq_trace_begin_file(&file, path);
+    char name[32];
+    for (int rank = 0; rank < world_size; rank++) {
+        seq_trace_event *events = buffer->events;
+        if (rank != 0) {
+            MPI_Recv(summary, 2, MPI_INT64_T, rank, TRACE_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+            events = (seq_trace_event *)malloc(summary[0] * sizeof(seq_trace_event) + 1);
+            MPI_Recv(events, summary[0] * sizeof(seq_trace_event), MPI_BYTE, rank, TRACE_TAG,
+                     MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        }
+        if (writing) {
+            snprintf(name, sizeof(name), "rank %d", rank);
+            seq_trace_write_names(&file, rank, name, 0, "wavefront");
+            seq_trace_write_events(&file, rank, 0, events, summary[0], summary[1], origin);
+        }
+        if (rank != 0) {
+            free(events);
+        }
+    }
+    if (writing) {
+        seq_trace_end_file(&file);
+        printf("Trace: %s\n", path);
+    }
 }
+#endif
 
 // ========================================
 // MATRIX RECONSTRUCTION FUNCTIONS
 // ========================================
 
 /**
- * Reconstructs the complete matrix at rank 0 for debugging
- * @param matrix The LCS matrix
- * @param total_row_blocks Total number of row blocks
- * @param total_col_blocks Total number of column blocks
- * @param sequence_a_length Length of sequence A
- * @param sequence_b_length Length of sequence B
- * @param world_size Number of MPI processes
- * @param current_rank Current MPI rank
+ * Reconstructs the complete matrix at rank 0 for debugging. Only the root
+ * allocates the full matrix, the other ranks send their blocks row by row
+ * @param matrix The full LCS matrix at the root, NULL elsewhere
+ * @param context Wavefront context
  */
-void reconstruct_matrix_at_root(matrix_element_type **matrix, int total_row_blocks,
-                                int total_col_blocks, int sequence_a_length, int sequence_b_length,
-                                int world_size, int current_rank) {
-#ifdef DEBUGMATRIX
+void reconstruct_matrix_at_root(matrix_element_type *matrix, const wavefront_context *context) {
+    int sequence_a_length = context->sequence_a_length;
     const int RECONSTRUCTION_TAG = 200;  // Tag for reconstruction communication
+    const block_mapping *mapping = &context->mapping;
 
-    if (current_rank == 0) {
-        // Root process receives all blocks from other processes
-        for (int block_row = 0; block_row < total_row_blocks; block_row++) {
-            for (int block_col = 0; block_col < total_col_blocks; block_col++) {
-                int owner_rank = (block_row * total_col_blocks + block_col) % world_size;
-
-                if (owner_rank != 0) {
-                    // Calculate exact block boundaries
-                    int row_start = block_row * BLOCK_SIZE + 1;
-                    int row_end = min((block_row + 1) * BLOCK_SIZE, sequence_b_length);
-                    int col_start = block_col * BLOCK_SIZE + 1;
-                    int col_end = min((block_col + 1) * BLOCK_SIZE, sequence_a_length);
-
-                    // Receive block data row by row
-                    for (int i = row_start; i <= row_end; i++) {
-                        MPI_Recv(&matrix[i][col_start], (col_end - col_start + 1),
-                                 MPI_UNSIGNED_SHORT, owner_rank, RECONSTRUCTION_TAG + i,
-                                 MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-                    }
+    for (int block_row = 0; block_row < mapping->total_row_blocks; block_row++) {
+        for (int block_col = 0; block_col < mapping->total_col_blocks; block_col++) {
+            int owner_rank = block_owner(mapping, block_row, block_col);
+            if (context->current_rank != 0 && owner_rank != context->current_rank) {
+                continue;
+            }
+
+            // Calculate exact block boundaries
+            int row_start = block_row * context->tile_height + 1;
+            int row_end = row_start + block_height(context, block_row) - 1;
+            int col_start = block_col * context->tile_width + 1;
+            int cols = block_width(context, block_col);
+
+            if (context->current_rank == 0 && owner_rank != 0) {
+                // Receive block data row by row
+                for (int i = row_start; i <= row_end; i++) {
+                    MPI_Recv(&MATRIX_ELEMENT(matrix, sequence_a_length, i, col_start), cols,
+                             MPI_UNSIGNED_SHORT, owner_rank, RECONSTRUCTION_TAG + i,
+                             MPI_COMM_WORLD, MPI_STATUS_IGNORE);
                 }
+                continue;
             }
-        }
-    } else {
-        // Other processes send their owned blocks to root
-        for (int block_row = 0; block_row < total_row_blocks; block_row++) {
-            for (int block_col = 0; block_col < total_col_blocks; block_col++) {
-                int owner_rank = (block_row * total_col_blocks + block_col) % world_size;
-
-                if (owner_rank == current_rank) {
-                    // Calculate exact block boundaries
-                    int row_start = block_row * BLOCK_SIZE + 1;
-                    int row_end = min((block_row + 1) * BLOCK_SIZE, sequence_b_length);
-                    int col_start = block_col * BLOCK_SIZE + 1;
-                    int col_end = min((block_col + 1) * BLOCK_SIZE, sequence_a_length);
 
+            matrix_element_type *block = get_local_block(context, block_row, block_col);
+            for (int i = row_start; i <= row_end; i++) {
+                matrix_element_type *block_row_data =
+                    &BLOCK_ELEMENT(block, context->tile_width, i - row_start + 1, 1);
+                if (context->current_rank == 0) {
+                    // Root copies its own blocks
+                    memcpy(&MATRIX_ELEMENT(matrix, sequence_a_length, i, col_start), block_row_data,
+                           cols * sizeof(matrix_element_type));
+                } else {
                     // Send block data row by row
-                    for (int i = row_start; i <= row_end; i++) {
-                        MPI_Send(&matrix[i][col_start], (col_end - col_start + 1),
-                                 MPI_UNSIGNED_SHORT, 0, RECONSTRUCTION_TAG + i, MPI_COMM_WORLD);
-                    }
+                    MPI_Send(block_row_data, cols, MPI_UNSIGNED_SHORT, 0, RECONSTRUCTION_TAG + i,
+                             MPI_COMM_WORLD);
                 }
             }
         }
     }
-#endif
+}
+
+// ========================================
+// TILE SHAPE FUNCTIONS
+// ========================================
+
+/**
+ * Sets up the block grid, the mapping and the owned blocks of a rank
+ * @param context Context to initialize
+ * @param sequences Encoded sequences, A gives the columns and B the rows
+ * @param sequence_a_length Length of the first sequence
+ * @param sequence_b_length Length of the second sequence
+ * @param current_rank Current MPI rank
+ * @param world_size Number of MPI processes
+ * @param strategy Block-to-rank distribution
+ * @param cyclic_width Block columns per group for MAPPING_BLOCK_CYCLIC
+ * @param tile_height Rows of B per block
+ * @param tile_width Columns of A per block
+ */
+void init_wavefront_context(wavefront_context *context, const encoded_sequences *sequences,
+                            int sequence_a_length, int sequence_b_length, int current_rank,
+                            int world_size, mapping_strategy strategy, int cyclic_width,
+                            int tile_height, int tile_width) {
+    context->sequences = sequences;
+    context->sequence_a_length = sequence_a_length;
+    context->sequence_b_length = sequence_b_length;
+    context->current_rank = current_rank;
+    context->tile_height = tile_height;
+    context->tile_width = tile_width;
+
+    // teto para calcular 1 bloco a mais caso divisao nao exata
+    int total_row_blocks = (sequence_b_length + tile_height - 1) / tile_height;
+    int total_col_blocks = (sequence_a_length + tile_width - 1) / tile_width;
+    context->mapping = create_block_mapping(strategy, total_row_blocks, total_col_blocks,
+                                            world_size, cyclic_width);
+    build_work_list(context);
+}
+
+/**
+ * Releases the work list and the owned blocks of a context
+ * @param context Context to release
+ */
+void free_wavefront_context(wavefront_context *context) {
+    seq_buffer_free(&context->local_storage);
+    free(context->work_list);
+    free(context->block_slots);
+}
+
+/**
+ * Parses a tile shape given with -t, HxW or a single edge for square tiles
+ * @param text Tile shape
+ * @param tile_height Parsed rows per block
+ * @param tile_width Parsed columns per block
+ * @return 1 on success, 0 for a malformed shape
+ */
+int parse_tile_shape(const char *text, int *tile_height, int *tile_width) {
+    int height, width;
+    int fields = sscanf(text, "%dx%d", &height, &width);
+    if (fields == 1) {
+        width = height;
+    } else if (fields != 2) {
+        return 0;
+    }
+    if (height <= 0 || width <= 0) {
+        return 0;
+    }
+    *tile_height = height;
+    *tile_width = width;
+    return 1;
+}
+
+/**
+ * Times a short wavefront on a prefix of the input for every candidate tile
+ * shape and keeps the fastest. The slowest rank decides the time of a shape,
+ * so all ranks agree on the result without a broadcast
+ * @param sequences Encoded sequences
+ * @param sequence_a_length Length of the first sequence
+ * @param sequence_b_length Length of the second sequence
+ * @param current_rank Current MPI rank
+ * @param world_size Number of MPI processes
+ * @param strategy Block-to-rank distribution of the real run
+ * @param cyclic_width Block columns per group for MAPPING_BLOCK_CYCLIC
+ * @param tile_height Chosen rows per block
+ * @param tile_width Chosen columns per block
+ * @return Time spent tuning
+ */
+double autotune_tile_shape(const encoded_sequences *sequences, int sequence_a_length,
+                           int sequence_b_length, int current_rank, int world_size,
+                           mapping_strategy strategy, int cyclic_width, int *tile_height,
+                           int *tile_width) {
+    int prefix_a_length = min(sequence_a_length, AUTOTUNE_PREFIX_LENGTH);
+    int prefix_b_length = min(sequence_b_length, AUTOTUNE_PREFIX_LENGTH);
+    int height_count = sizeof(autotune_tile_heights) / sizeof(autotune_tile_heights[0]);
+    int width_count = sizeof(autotune_tile_widths) / sizeof(autotune_tile_widths[0]);
+    double best_time = 0;
+    double start_time = MPI_Wtime();
+
+    for (int h = 0; h < height_count; h++) {
+        for (int w = 0; w < width_count; w++) {
+            wavefront_context context;
+            init_wavefront_context(&context, sequences, prefix_a_length,
+                                   prefix_b_length, current_rank, world_size, strategy,
+                                   cyclic_width, autotune_tile_heights[h], autotune_tile_widths[w]);
+
+            MPI_Barrier(MPI_COMM_WORLD);
+            double candidate_start = MPI_Wtime();
+            run_wavefront(&context, NULL);
+            double candidate_time = MPI_Wtime() - candidate_start;
+            MPI_Allreduce(MPI_IN_PLACE, &candidate_time, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+
+            if ((h == 0 && w == 0) || candidate_time < best_time) {
+                best_time = candidate_time;
+                *tile_height = autotune_tile_heights[h];
+                *tile_width = autotune_tile_widths[w];
+            }
+            free_wavefront_context(&context);
+        }
+    }
+    return MPI_Wtime() - start_time;
 }
 
 // ========================================
 // MAIN FUNCTION
 // ========================================
 
+/**
+ * Parses a mapping name given with -d
+ * @param name Mapping name
+ * @param strategy Parsed strategy
+ * @return 1 on success, 0 for an unknown name
+ */
+int parse_mapping_strategy(const char *name, mapping_strategy *strategy) {
+    if (strcmp(name, "rr") == 0) {
+        *strategy = MAPPING_ROUND_ROBIN;
+    } else if (strcmp(name, "strip") == 0) {
+        *strategy = MAPPING_COLUMN_STRIP;
+    } else if (strcmp(name, "cyclic") == 0) {
+        *strategy = MAPPING_BLOCK_CYCLIC;
+    } else if (strcmp(name, "2d") == 0) {
+        *strategy = MAPPING_2D_CYCLIC;
+    } else {
+        return 0;
+    }
+    return 1;
+}
+
 int main(int argc, char **argv) {
     int current_rank, world_size;
     MPI_Init(&argc, &argv);
     MPI_Comm_rank(MPI_COMM_WORLD, &current_rank);
     MPI_Comm_size(MPI_COMM_WORLD, &world_size);
 
-    char *sequence_a, *sequence_b;
+    // Every rank parses the options, mpirun passes them to all
+    mapping_strategy strategy = MAPPING_ROUND_ROBIN;
+    int cyclic_width = 1;
+    int tile_height = BLOCK_SIZE, tile_width = BLOCK_SIZE, autotune = 0;
+    const char *checkpoint_prefix = NULL;
+    int checkpoint_interval = CHECKPOINT_INTERVAL;
+    int option, valid_options = 1;
+    while ((option = getopt(argc, argv, "d:w:t:c:i:")) != -1) {
+        if (option == 'd') {
+            valid_options = valid_options && parse_mapping_strategy(optarg, &strategy);
+        } else if (option == 'w') {
+            cyclic_width = atoi(optarg);
+        } else if (option == 't' && strcmp(optarg, "auto") == 0) {
+            autotune = 1;
+        } else if (option == 't') {
+            valid_options = valid_options && parse_tile_shape(optarg, &tile_height, &tile_width);
+        } else if (option == 'c') {
+            checkpoint_prefix = optarg;
+        } else if (option == 'i') {
+            checkpoint_interval = atoi(optarg);
+            valid_options = valid_options && checkpoint_interval > 0;
+        } else {
+            valid_options = 0;
+        }
+    }
+    if (!valid_options || argc - optind < 2) {
+        if (current_rank == 0) {
+            printf("Usage: mpirun -np <num_procs> %s [-d rr|strip|cyclic|2d] [-w cyclic_width] "
+                   "[-t HxW|auto] [-c checkpoint [-i interval]] <fileA.in> <fileB.in>\n",
+                   argv[0]);
+            printf("  -t sets the rows x columns of a block (default %dx%d), auto times a few\n"
+                   "     shapes first; any size works, edges past the matrix are clipped\n",
+                   BLOCK_SIZE, BLOCK_SIZE);
+            printf("  -c appends a record to checkpoint.<rank> every interval block antidiagonals "
+                   "(default %d)\n     and resumes from the latest one all ranks reached\n",
+                   CHECKPOINT_INTERVAL);
+        }
+        MPI_Finalize();
+        return EXIT_FAILURE;
+    }
+
+    char *sequence_a = NULL, *sequence_b = NULL;
     int sequence_a_length = 0, sequence_b_length = 0;
 
-    // Root process reads input sequences
+    // Root process maps the input files, the first record of each is the sequence
+    seq_records file_a, file_b;
     if (current_rank == 0) {
-        if (argc < 3) {
-            printf("Usage: mpirun -np <num_procs> %s <fileA.in> <fileB.in>\n", argv[0]);
-            MPI_Abort(MPI_COMM_WORLD, 1);
-        }
-        sequence_a = read_sequence_from_file(argv[1]);
-        sequence_b = read_sequence_from_file(argv[2]);
-        sequence_a_length = strlen(sequence_a);
-        sequence_b_length = strlen(sequence_b);
+        file_a = seq_load_records(argv[optind], SEQ_JOIN_LINES);
+        file_b = seq_load_records(argv[optind + 1], SEQ_JOIN_LINES);
+        sequence_a = file_a.seqs[0];
+        sequence_b = file_b.seqs[0];
+        sequence_a_length = file_a.lengths[0];
+        sequence_b_length = file_b.lengths[0];
+    }
+
+    // 16-bit cells, longer alignments wrap around
+    if (current_rank == 0 && min(sequence_a_length, sequence_b_length) > MATRIX_ELEMENT_MAX) {
+        printf("Warning: scores above %d overflow matrix_element_type.\n", MATRIX_ELEMENT_MAX);
     }
 
     // Broadcast sequence lengths and sequences to all processes
     MPI_Bcast(&sequence_a_length, 1, MPI_INT, 0, MPI_COMM_WORLD);
     MPI_Bcast(&sequence_b_length, 1, MPI_INT, 0, MPI_COMM_WORLD);
 
+    // Sequences travel packed, 2 bits per character for DNA instead of 8
+    seq_alphabet alphabet;
+    uint8_t *packed_a = NULL, *packed_b = NULL;
+    if (current_rank == 0) {
+        alphabet = seq_alphabet_of(sequence_a, sequence_a_length, sequence_b, sequence_b_length);
+        packed_a = seq_pack(&alphabet, sequence_a, sequence_a_length);
+        packed_b = seq_pack(&alphabet, sequence_b, sequence_b_length);
+    }
+    MPI_Bcast(&alphabet, sizeof(alphabet), MPI_BYTE, 0, MPI_COMM_WORLD);
+
+    size_t packed_a_size = seq_packed_size(&alphabet, sequence_a_length);
+    size_t packed_b_size = seq_packed_size(&alphabet, sequence_b_length);
     if (current_rank != 0) {
-        sequence_a = (char *)malloc((sequence_a_length + 1) * sizeof(char));
-        sequence_b = (char *)malloc((sequence_b_length + 1) * sizeof(char));
+        packed_a = (uint8_t *)calloc(packed_a_size + 1, 1);
+        packed_b = (uint8_t *)calloc(packed_b_size + 1, 1);
     }
 
-    MPI_Bcast(sequence_a, sequence_a_length + 1, MPI_CHAR, 0, MPI_COMM_WORLD);
-    MPI_Bcast(sequence_b, sequence_b_length + 1, MPI_CHAR, 0, MPI_COMM_WORLD);
+    MPI_Bcast(packed_a, packed_a_size, MPI_BYTE, 0, MPI_COMM_WORLD);
+    MPI_Bcast(packed_b, packed_b_size, MPI_BYTE, 0, MPI_COMM_WORLD);
 
-    // Initialize LCS matrix
-    matrix_element_type **lcs_matrix = allocate_lcs_matrix(sequence_a_length, sequence_b_length);
-    initialize_lcs_matrix(lcs_matrix, sequence_a_length, sequence_b_length);
+    // Blocks look characters of A up through its match profile, B stays packed
+    encoded_sequences sequences;
+    sequences.profile_a = seq_profile(&alphabet, packed_a, sequence_a_length);
+    sequences.profile_words = seq_profile_words(sequence_a_length);
+    sequences.packed_b = packed_b;
+    sequences.symbol_bits = alphabet.bits;
 
-    // Calculate block dimensions
-    // teto para calcular 1 bloco a mais caso divisao nao exata
-    int total_row_blocks = (sequence_b_length + BLOCK_SIZE - 1) / BLOCK_SIZE;
-    int total_col_blocks = (sequence_a_length + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    // A checkpoint is only resumed by the same input, tile shape, mapping and ranks
+    seq_checkpoint_header header = seq_checkpoint_header_of(
+        packed_a, packed_a_size, sequence_a_length, packed_b, packed_b_size, sequence_b_length,
+        0, 0);
+    header.layout[0] = strategy;
+    header.layout[1] = cyclic_width;
+    header.layout[2] = world_size;
+    header.layout[3] = current_rank;
+    free(packed_a);
+
+    // A restart keeps the shape the interrupted run was tuned to, when every
+    // rank's log holds the same one
+    if (autotune && checkpoint_prefix != NULL) {
+        char path[4096];
+        snprintf(path, sizeof(path), "%s.%d", checkpoint_prefix, current_rank);
+        uint32_t saved_height = 0, saved_width = 0;
+        seq_checkpoint_tile(path, &header, &saved_height, &saved_width);
+        int saved[4] = {(int)saved_height, (int)saved_width, -(int)saved_height,
+                        -(int)saved_width};
+        MPI_Allreduce(MPI_IN_PLACE, saved, 4, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+        if (saved[0] > 0 && saved[0] == -saved[2] && saved[1] == -saved[3]) {
+            tile_height = saved[0];
+            tile_width = saved[1];
+            autotune = 0;
+        }
+    }
+
+    // Calibration wavefronts on a prefix of the input, every rank gets the same answer
+    if (autotune) {
+        double tuning_time = autotune_tile_shape(&sequences, sequence_a_length, sequence_b_length,
+                                                 current_rank, world_size, strategy, cyclic_width,
+                                                 &tile_height, &tile_width);
+        if (current_rank == 0) {
+            printf("AUTOTUNE: %fs\n", tuning_time);
+        }
+    }
+    // A tile larger than the matrix only adds halo storage
+    tile_height = min(tile_height, max(sequence_b_length, 1));
+    tile_width = min(tile_width, max(sequence_a_length, 1));
+    if (current_rank == 0) {
+        printf("Tile: %dx%d\n", tile_height, tile_width);
+    }
+
+    // Each rank only lists and stores the blocks it owns, with their halos
+    wavefront_context context;
+    init_wavefront_context(&context, &sequences, sequence_a_length, sequence_b_length,
+                           current_rank, world_size, strategy, cyclic_width, tile_height,
+                           tile_width);
+    if (current_rank == 0) {
+        printf("Pages: %s\n", seq_buffer_pages(&context.local_storage));
+    }
+    int total_row_blocks = context.mapping.total_row_blocks;
+    int total_col_blocks = context.mapping.total_col_blocks;
+
+    header.tile_height = tile_height;
+    header.tile_width = tile_width;
+
+    checkpoint_log log;
+    checkpoint_open(&log, &context, checkpoint_prefix, checkpoint_interval, &header);
+    if (current_rank == 0 && log.resume_diagonal > 0) {
+        printf("Resumed at block antidiagonal %d of %d\n", log.resume_diagonal,
+               log.total_diagonals);
+    }
+
+#ifdef LCS_TRACE
+    // the clocks are compared before the timed run so the probes stay out of it
+    int64_t trace_offset = trace_clock_offset(current_rank, world_size);
+    seq_trace_buffer rank_trace = {NULL, 0, 0};
+    trace_buffer = &rank_trace;
+#endif
 
     // Start timing
     double start_time, end_time;
     MPI_Barrier(MPI_COMM_WORLD);
     start_time = MPI_Wtime();
+#ifdef LCS_TRACE
+    uint64_t trace_origin = seq_trace_now();
+#endif
+
+#ifdef LCS_PERF
+    seq_perf_counters rank_counters;
+    seq_perf_open(&rank_counters);
+    block_counters = &rank_counters;
+#endif
 
     // *** WAVEFRONT ALGORITHM EXECUTION ***
-    // Process blocks diagonally to respect dependencies
-    for (int diagonal = 0; diagonal < total_row_blocks + total_col_blocks - 1; ++diagonal) {
-        // Calculate which blocks belong to this diagonal
-        int min_block_row = max(0, diagonal - total_col_blocks + 1);
-        int max_block_row = min(diagonal, total_row_blocks - 1);
-
-        for (int block_row = min_block_row; block_row <= max_block_row; ++block_row) {
-            int block_col = diagonal - block_row;
-            // Distributes the blocks cyclically with the mod operator: 0, 1, 2, 3, 0, 1 ...
-            int owner_rank = (block_row * total_col_blocks + block_col) % world_size;
+    run_wavefront(&context, &log);
+    checkpoint_close(&log);
 
-            // Only the owner process works on this block
-            if (current_rank == owner_rank) {
-                process_wavefront_block(lcs_matrix, sequence_a, sequence_b, block_row, block_col,
-                                        sequence_a_length, sequence_b_length, total_row_blocks,
-                                        total_col_blocks, world_size);
+    // The final score is the last element of the last block, send it to the root
+    matrix_element_type final_lcs_score = 0;
+    if (total_row_blocks > 0 && total_col_blocks > 0) {
+        int last_owner = block_owner(&context.mapping, total_row_blocks - 1, total_col_blocks - 1);
+        if (current_rank == last_owner) {
+            matrix_element_type *last_block =
+                get_local_block(&context, total_row_blocks - 1, total_col_blocks - 1);
+            final_lcs_score = BLOCK_ELEMENT(last_block, tile_width,
+                                            block_height(&context, total_row_blocks - 1),
+                                            block_width(&context, total_col_blocks - 1));
+            if (last_owner != 0) {
+                MPI_Send(&final_lcs_score, 1, MPI_UNSIGNED_SHORT, 0, SCORE_TAG, MPI_COMM_WORLD);
             }
         }
+        if (current_rank == 0 && last_owner != 0) {
+            MPI_Recv(&final_lcs_score, 1, MPI_UNSIGNED_SHORT, last_owner, SCORE_TAG,
+                     MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        }
     }
 
     // End timing
     MPI_Barrier(MPI_COMM_WORLD);
     end_time = MPI_Wtime();
 
-    // Reconstruct complete matrix at root for debugging
-    reconstruct_matrix_at_root(lcs_matrix, total_row_blocks, total_col_blocks, sequence_a_length,
-                               sequence_b_length, world_size, current_rank);
+#ifdef DEBUGMATRIX
+    // Reconstruct complete matrix at root for debugging, the only full copy
+    seq_buffer lcs_matrix = {NULL, 0, 0, SEQ_PAGES_SMALL};
+    if (current_rank == 0) {
+        lcs_matrix = allocate_lcs_matrix(sequence_a_length, sequence_b_length);
+        initialize_lcs_matrix(lcs_matrix.data, sequence_a_length, sequence_b_length);
+    }
+    reconstruct_matrix_at_root(lcs_matrix.data, &context);
+    if (current_rank == 0) {
+        print_lcs_matrix(sequence_a, sequence_b, lcs_matrix.data, sequence_a_length,
+                         sequence_b_length);
+        free_lcs_matrix(&lcs_matrix);
+    }
+#endif
 
     // Collect and print results
     if (current_rank == 0) {
-        matrix_element_type final_lcs_score = lcs_matrix[sequence_b_length][sequence_a_length];
-
-        // Uncomment the line below to print the complete matrix for debugging
-        // print_lcs_matrix(sequence_a, sequence_b, lcs_matrix, sequence_a_length,
-        // sequence_b_length);
-
         printf("\nScore: %d\n", final_lcs_score);
         printf("PARALLEL: %fs\n", end_time - start_time);
     }
 
+#ifdef LCS_PERF
+    // Counts of the block computations of every rank, printed by the root
+    seq_perf_close(&rank_counters);
+    block_counters = NULL;
+    seq_perf_counters *all_counters = NULL;
+    if (current_rank == 0) {
+        all_counters = (seq_perf_counters *)malloc(world_size * sizeof(seq_perf_counters));
+    }
+    MPI_Gather(&rank_counters, sizeof(rank_counters), MPI_BYTE, all_counters,
+               sizeof(rank_counters), MPI_BYTE, 0, MPI_COMM_WORLD);
+    if (current_rank == 0) {
+        seq_perf_counters total = {{0}};
+        char label[32];
+        for (int rank = 0; rank < world_size; rank++) {
+            snprintf(label, sizeof(label), "Perf rank %d", rank);
+            seq_perf_print(stdout, label, &all_counters[rank]);
+            seq_perf_add(&total, &all_counters[rank]);
+        }
+        seq_perf_print(stdout, "Perf total", &total);
+        free(all_counters);
+    }
+#endif
+
+#ifdef LCS_TRACE
+    trace_buffer = NULL;
+    write_trace_at_root(&rank_trace, trace_offset, trace_origin, current_rank, world_size);
+    seq_trace_free(&rank_trace);
+#endif
+
     // Cleanup
-    free_lcs_matrix(lcs_matrix, sequence_b_length);
-    free(sequence_a);
-    free(sequence_b);
+    free_wavefront_context(&context);
+    free(sequences.profile_a);
+    free(sequences.packed_b);
+    if (current_rank == 0) {
+        seq_free_records(&file_a);
+        seq_free_records(&file_b);
+    }
     MPI_Finalize();
 
     return EXIT_SUCCESS;
@@ -1,68 +1,532 @@
+#define _GNU_SOURCE
 #include <omp.h>
+#include <sched.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+#include "seq_alloc.h"
+#include "seq_checkpoint.h"
+#include "seq_encode.h"
+#include "seq_loader.h"
+
+#ifdef LCS_PERF
+#include "seq_perf.h"
+#endif
+
+#ifdef LCS_TRACE
+#include "seq_trace.h"
+#endif
 
 /* #define DEBUGMATRIX */
 /* #define DEBUGSTEPS */
 
 typedef unsigned short mtype;
 
+// engines selectable with -m
+typedef enum {
+    MODE_MATRIX,
+    MODE_DIAGONAL,
+    MODE_LINEAR,
+    MODE_TILED,
+    MODE_PIPELINE,
+    MODE_BITS,
+    MODE_BATCH,
+    MODE_ALLPAIRS
+} lcsMode;
+
+// largest score an mtype cell holds, the bit engine has no such limit
+#define MTYPE_MAX 65535
+
+// Default tile edge of the tiled engines, 256x256 cells of working set stay in L1/L2
+#define TILE_SIZE 256
+
+// Default tile of the bit engine in rows x columns, 64 columns per word op so
+// tiles are wider to keep the task overhead small
+#define BIT_TILE_HEIGHT 512
+#define BIT_TILE_WIDTH 8192
+
+// -t auto times the tiled engine on a prefix of this many characters of each
+// sequence for every pair of candidate height and width, and keeps the fastest
+#define AUTOTUNE_PREFIX 4096
+static const size_t tileCandidates[] = {64, 128, 256, 512, 1024};
+
+// Rows of B and columns of A per tile, rectangular tiles allowed
+typedef struct {
+    size_t height;
+    size_t width;
+} tileShape;
+
+// Snapshots of the tiled engine, enabled with -c. Every interval antidiagonals
+// of tiles the frontier is copied and written by a task while the next
+// antidiagonals are computed. Autotuning never checkpoints
+#define CHECKPOINT_INTERVAL 64
+typedef struct {
+    const char *path;  // NULL when disabled
+    size_t interval;
+} tileCheckpoint;
+tileCheckpoint checkpoint = {NULL, CHECKPOINT_INTERVAL};
+
+// Cells of an antidiagonal are split among threads in multiples of this, so
+// only the last chunk of the diagonal runs a scalar tail
+#define DIAG_KERNEL_ALIGN 32
+
+// Busy-wait iterations before a waiting thread yields its core
+#define SPIN_BEFORE_YIELD 1024
+
+// Hirschberg traceback: subproblems above PARALLEL_CELLS compute their rows with a
+// parallel antidiagonal sweep, those above TASK_CELLS split into OpenMP tasks and
+// those below BASE_CELLS are solved with a small full table
+#define HIRSCHBERG_PARALLEL_CELLS ((size_t)1 << 24)
+#define HIRSCHBERG_TASK_CELLS ((size_t)1 << 16)
+#define HIRSCHBERG_BASE_CELLS ((size_t)1 << 12)
+
 // Macro to access the flattened score array
 #define SCORE(i, j) scoreArray[(size_t)(i) * (sizeA + 1) + (j)]
 
-// Read sequence from a file into a char vector
-char *read_seq(const char *fname) {
-    FILE *fseq = fopen(fname, "rt");
-    if (!fseq) {
-        fprintf(stderr, "Error reading file %s\n", fname);
-        exit(EXIT_FAILURE);
+// Antidiagonal update of count cells, every pointer already at the first cell:
+// curr[k] = rowB[k] == colA[k] ? diag[k] + 1 : max(up[k], left[k])
+typedef void (*diagKernelFn)(mtype *restrict curr, const mtype *up, const mtype *left,
+                             const mtype *diag, const char *rowB, const char *colA, size_t count);
+
+void diagKernelScalar(mtype *restrict curr, const mtype *up, const mtype *left, const mtype *diag,
+                      const char *rowB, const char *colA, size_t count) {
+    for (size_t k = 0; k < count; k++) {
+        mtype best = up[k] > left[k] ? up[k] : left[k];
+        curr[k] = rowB[k] == colA[k] ? diag[k] + 1 : best;
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+// 8 cells per step: byte compare widened to a 16-bit mask, max and blend
+__attribute__((target("sse4.1"))) void diagKernelSSE41(mtype *restrict curr, const mtype *up,
+                                                       const mtype *left, const mtype *diag,
+                                                       const char *rowB, const char *colA,
+                                                       size_t count) {
+    const __m128i one = _mm_set1_epi16(1);
+    size_t k = 0;
+    for (; k + 8 <= count; k += 8) {
+        __m128i eq = _mm_cmpeq_epi8(_mm_loadl_epi64((const __m128i *)(rowB + k)),
+                                    _mm_loadl_epi64((const __m128i *)(colA + k)));
+        __m128i mask = _mm_cvtepi8_epi16(eq);
+        __m128i best = _mm_max_epu16(_mm_loadu_si128((const __m128i *)(up + k)),
+                                     _mm_loadu_si128((const __m128i *)(left + k)));
+        __m128i match = _mm_add_epi16(_mm_loadu_si128((const __m128i *)(diag + k)), one);
+        _mm_storeu_si128((__m128i *)(curr + k), _mm_blendv_epi8(best, match, mask));
+    }
+    diagKernelScalar(curr + k, up + k, left + k, diag + k, rowB + k, colA + k, count - k);
+}
+
+// 16 cells per step
+__attribute__((target("avx2"))) void diagKernelAVX2(mtype *restrict curr, const mtype *up,
+                                                    const mtype *left, const mtype *diag,
+                                                    const char *rowB, const char *colA,
+                                                    size_t count) {
+    const __m256i one = _mm256_set1_epi16(1);
+    size_t k = 0;
+    for (; k + 16 <= count; k += 16) {
+        __m128i eq = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(rowB + k)),
+                                    _mm_loadu_si128((const __m128i *)(colA + k)));
+        __m256i mask = _mm256_cvtepi8_epi16(eq);
+        __m256i best = _mm256_max_epu16(_mm256_loadu_si256((const __m256i *)(up + k)),
+                                        _mm256_loadu_si256((const __m256i *)(left + k)));
+        __m256i match = _mm256_add_epi16(_mm256_loadu_si256((const __m256i *)(diag + k)), one);
+        _mm256_storeu_si256((__m256i *)(curr + k), _mm256_blendv_epi8(best, match, mask));
+    }
+    diagKernelScalar(curr + k, up + k, left + k, diag + k, rowB + k, colA + k, count - k);
+}
+
+// 32 cells per step, the compare goes straight to a mask register and the
+// tail uses masked loads and stores instead of a scalar loop
+__attribute__((target("avx512bw,avx512vl"))) void diagKernelAVX512(
+    mtype *restrict curr, const mtype *up, const mtype *left, const mtype *diag, const char *rowB,
+    const char *colA, size_t count) {
+    const __m512i one = _mm512_set1_epi16(1);
+    for (size_t k = 0; k < count; k += 32) {
+        __mmask32 lanes = count - k >= 32 ? 0xFFFFFFFFu : (1u << (count - k)) - 1;
+        __mmask32 eq = _mm256_mask_cmpeq_epi8_mask(lanes, _mm256_maskz_loadu_epi8(lanes, rowB + k),
+                                                   _mm256_maskz_loadu_epi8(lanes, colA + k));
+        __m512i best = _mm512_max_epu16(_mm512_maskz_loadu_epi16(lanes, up + k),
+                                        _mm512_maskz_loadu_epi16(lanes, left + k));
+        __m512i match = _mm512_add_epi16(_mm512_maskz_loadu_epi16(lanes, diag + k), one);
+        _mm512_mask_storeu_epi16(curr + k, lanes, _mm512_mask_blend_epi16(eq, best, match));
+    }
+}
+#endif
+
+// Kernel used by the antidiagonal engines, picked once at startup
+diagKernelFn diagKernel = diagKernelScalar;
+
+// Batch modes: BATCH_LANES independent pairs run the LCS recurrence in
+// lockstep, one pair per 16-bit lane. All lanes share the query along the row
+// and lane k walks down its own target, padded with '\0' (never part of a
+// sequence) so a short target just repeats its last row until the longest is done
+#define BATCH_LANES 32
+typedef mtype batchVec __attribute__((vector_size(BATCH_LANES * sizeof(mtype))));
+
+// Scores query against lanes targets, row holds sizeQ + 1 vectors of scratch
+typedef void (*batchKernelFn)(const char *query, size_t sizeQ, const char *const *targets,
+                              const size_t *sizes, size_t lanes, batchVec *row, mtype *scores);
+
+// Written once with vector extensions, the wrappers below compile it per ISA
+static inline __attribute__((always_inline)) void batchKernelBody(
+    const char *query, size_t sizeQ, const char *const *targets, const size_t *sizes, size_t lanes,
+    batchVec *row, mtype *scores) {
+    size_t rows = 0;
+    for (size_t k = 0; k < lanes; k++) rows = sizes[k] > rows ? sizes[k] : rows;
+    memset(row, 0, (sizeQ + 1) * sizeof(batchVec));
+
+    for (size_t i = 0; i < rows; i++) {
+        batchVec rowChars = {0};
+        for (size_t k = 0; k < lanes; k++)
+            rowChars[k] = i < sizes[k] ? (unsigned char)targets[k][i] : 0;
+
+        batchVec diag = row[0];
+        batchVec left = row[0];
+        for (size_t j = 1; j <= sizeQ; j++) {
+            batchVec up = row[j];
+            batchVec eq = (batchVec)(rowChars == (mtype)(unsigned char)query[j - 1]);
+            batchVec gt = (batchVec)(left > up);
+            batchVec best = (up & ~gt) | (left & gt);
+            batchVec value = ((diag + 1) & eq) | (best & ~eq);
+            diag = up;
+            row[j] = value;
+            left = value;
+        }
     }
-    fseek(fseq, 0L, SEEK_END);
-    long size = ftell(fseq);
-    rewind(fseq);
+    for (size_t k = 0; k < lanes; k++) scores[k] = row[sizeQ][k];
+}
+
+void batchKernelScalar(const char *query, size_t sizeQ, const char *const *targets,
+                       const size_t *sizes, size_t lanes, batchVec *row, mtype *scores) {
+    batchKernelBody(query, sizeQ, targets, sizes, lanes, row, scores);
+}
 
-    char *seq = calloc(size + 1, sizeof(char));
-    if (!seq) {
-        fprintf(stderr, "Error allocating memory for sequence %s.\n", fname);
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("sse4.1"))) void batchKernelSSE41(const char *query, size_t sizeQ,
+                                                        const char *const *targets,
+                                                        const size_t *sizes, size_t lanes,
+                                                        batchVec *row, mtype *scores) {
+    batchKernelBody(query, sizeQ, targets, sizes, lanes, row, scores);
+}
+
+__attribute__((target("avx2"))) void batchKernelAVX2(const char *query, size_t sizeQ,
+                                                     const char *const *targets,
+                                                     const size_t *sizes, size_t lanes,
+                                                     batchVec *row, mtype *scores) {
+    batchKernelBody(query, sizeQ, targets, sizes, lanes, row, scores);
+}
+
+__attribute__((target("avx512bw,avx512vl"))) void batchKernelAVX512(
+    const char *query, size_t sizeQ, const char *const *targets, const size_t *sizes,
+    size_t lanes, batchVec *row, mtype *scores) {
+    batchKernelBody(query, sizeQ, targets, sizes, lanes, row, scores);
+}
+#endif
+
+// Kernel used by the batch modes, picked together with diagKernel
+batchKernelFn batchKernel = batchKernelScalar;
+
+// Names -k accepts, whether or not this CPU runs them
+static const char *const diagKernelNames[] = {"auto", "scalar", "sse41", "avx2", "avx512bw"};
+
+int isDiagKernelName(const char *name) {
+    for (size_t k = 0; k < sizeof(diagKernelNames) / sizeof(diagKernelNames[0]); k++)
+        if (strcmp(name, diagKernelNames[k]) == 0) return 1;
+    return 0;
+}
+
+// Picks the widest kernels the CPU supports, or the ones named by request,
+// one of diagKernelNames. Returns its name, NULL if the request can't run on
+// this CPU
+const char *selectDiagKernel(const char *request) {
+    int isAuto = strcmp(request, "auto") == 0;
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if ((isAuto || strcmp(request, "avx512bw") == 0) && __builtin_cpu_supports("avx512bw") &&
+        __builtin_cpu_supports("avx512vl")) {
+        diagKernel = diagKernelAVX512;
+        batchKernel = batchKernelAVX512;
+        return "avx512bw";
+    }
+    if ((isAuto || strcmp(request, "avx2") == 0) && __builtin_cpu_supports("avx2")) {
+        diagKernel = diagKernelAVX2;
+        batchKernel = batchKernelAVX2;
+        return "avx2";
+    }
+    if ((isAuto || strcmp(request, "sse41") == 0) && __builtin_cpu_supports("sse4.1")) {
+        diagKernel = diagKernelSSE41;
+        batchKernel = batchKernelSSE41;
+        return "sse41";
+    }
+#endif
+    if (isAuto || strcmp(request, "scalar") == 0) {
+        diagKernel = diagKernelScalar;
+        batchKernel = batchKernelScalar;
+        return "scalar";
+    }
+    return NULL;
+}
+
+// Share [lo, hi) of thread t out of nthreads of the count cells of an
+// antidiagonal, kernel-aligned
+static inline void antidiagonalShare(size_t count, size_t t, size_t nthreads, size_t *lo,
+                                     size_t *hi) {
+    *lo = (count * t / nthreads) / DIAG_KERNEL_ALIGN * DIAG_KERNEL_ALIGN;
+    *hi = (count * (t + 1) / nthreads) / DIAG_KERNEL_ALIGN * DIAG_KERNEL_ALIGN;
+    if (t + 1 == nthreads) *hi = count;
+}
+
+// Runs diagKernel over the cells a in [a_min, a_max] of one antidiagonal. The
+// buffers are indexed by a, colA starts at the character of A for the cell
+// a_min so that it never points outside the sequence
+void updateAntidiagonal(mtype *curr, const mtype *prev1, const mtype *prev2, const char *seqB,
+                        const char *colA, int a_min, int a_max) {
+    size_t count = a_max - a_min + 1;
+#pragma omp parallel
+    {
+        size_t lo, hi;
+        antidiagonalShare(count, omp_get_thread_num(), omp_get_num_threads(), &lo, &hi);
+        if (hi > lo) {
+            size_t a = a_min + lo;
+            diagKernel(curr + a, prev1 + a - 1, prev1 + a, prev2 + a - 1, seqB + a - 1, colA + lo,
+                       hi - lo);
+        }
+    }
+}
+
+// Antidiagonal-major score storage: the cells of antidiagonal d = a + b are
+// contiguous and ordered by a. base[d] is the offset of the diagonal minus its
+// first a, so a cell is one lookup and an add away
+typedef struct {
+    mtype *cells;
+    size_t *base;
+    seq_buffer memory;  // Backs cells
+} diagStore;
+
+#define DSCORE(store, a, b) (store).cells[(store).base[(a) + (b)] + (a)]
+
+// CPUs this process may run on, node by node, and the node of each. Falls
+// back to the affinity mask in CPU order, node unknown (-1), without
+// /sys/devices/system/node. Returns the number of CPUs listed
+int numaCpuOrder(int *cpus, int *nodes) {
+    cpu_set_t allowed, listed;
+    CPU_ZERO(&listed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) return 0;
+
+    int count = 0;
+    for (int node = 0; node < CPU_SETSIZE; node++) {
+        char path[64];
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+        FILE *f = fopen(path, "r");
+        if (!f) {
+            if (node > 0 && access("/sys/devices/system/node", F_OK) == 0) continue;
+            break;
+        }
+        // ranges such as 0-15,32-47
+        int first, last;
+        while (fscanf(f, "%d", &first) == 1) {
+            last = first;
+            if (fgetc(f) == '-' && fscanf(f, "%d", &last) == 1) fgetc(f);
+            for (int cpu = first; cpu <= last && cpu < CPU_SETSIZE; cpu++) {
+                if (CPU_ISSET(cpu, &allowed) && !CPU_ISSET(cpu, &listed)) {
+                    CPU_SET(cpu, &listed);
+                    cpus[count] = cpu;
+                    nodes[count++] = node;
+                }
+            }
+        }
+        fclose(f);
+    }
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (CPU_ISSET(cpu, &allowed) && !CPU_ISSET(cpu, &listed)) {
+            cpus[count] = cpu;
+            nodes[count++] = -1;
+        }
+    }
+    return count;
+}
+
+// Pins the threads of the team spread over the CPUs in node order, the way
+// OMP_PROC_BIND=spread does over one place per CPU: thread t gets CPU
+// t * cpus / threads, so neighbouring threads, which own neighbouring rows,
+// share a node and the team covers every node. Left to the runtime when
+// OMP_PROC_BIND or OMP_PLACES is set. libgomp keeps the same threads in the
+// same positions from one parallel region to the next, so the binding holds
+// for every region of the same size
+void bindThreads(int report) {
+    if (getenv("OMP_PROC_BIND") || getenv("OMP_PLACES")) {
+        if (report) printf("NUMA: binding left to OMP_PROC_BIND/OMP_PLACES\n");
+    } else {
+        static int cpus[CPU_SETSIZE], nodes[CPU_SETSIZE];
+        int count = numaCpuOrder(cpus, nodes);
+        if (count > 0) {
+#pragma omp parallel
+            {
+                cpu_set_t set;
+                CPU_ZERO(&set);
+                CPU_SET(cpus[(size_t)omp_get_thread_num() * count / omp_get_num_threads()], &set);
+                sched_setaffinity(0, sizeof(set), &set);
+            }
+        }
+    }
+    if (!report) return;
+
+    int threads = omp_get_max_threads();
+    unsigned *where = calloc(2 * threads, sizeof(unsigned));
+    if (!where) return;
+#pragma omp parallel
+    {
+        int t = omp_get_thread_num();
+        syscall(SYS_getcpu, &where[2 * t], &where[2 * t + 1], NULL);
+    }
+    for (int t = 0; t < threads; t++)
+        printf("NUMA: thread %d on cpu %u node %u\n", t, where[2 * t], where[2 * t + 1]);
+    free(where);
+}
+
+// Prints how many pages of the bytes at data sit on each node, by asking
+// move_pages where they are without moving them
+void reportPlacement(const char *name, const void *data, size_t bytes) {
+    enum { BATCH = 4096, MAX_NODES = 64 };
+    size_t pageSize = sysconf(_SC_PAGESIZE);
+    uintptr_t first = (uintptr_t)data / pageSize * pageSize;
+    size_t pages = ((uintptr_t)data + bytes - first + pageSize - 1) / pageSize;
+
+    size_t perNode[MAX_NODES] = {0}, elsewhere = 0;
+    void *batch[BATCH];
+    int status[BATCH];
+    for (size_t p = 0; p < pages; p += BATCH) {
+        size_t n = pages - p < BATCH ? pages - p : BATCH;
+        for (size_t i = 0; i < n; i++) batch[i] = (void *)(first + (p + i) * pageSize);
+        if (syscall(SYS_move_pages, 0, n, batch, NULL, status, 0) != 0) {
+            printf("NUMA: %s placement unavailable\n", name);
+            return;
+        }
+        for (size_t i = 0; i < n; i++) {
+            if (status[i] >= 0 && status[i] < MAX_NODES)
+                perNode[status[i]]++;
+            else
+                elsewhere++;  // not faulted in, or swapped out
+        }
+    }
+    printf("NUMA: %s %zu pages", name, pages);
+    for (int node = 0; node < MAX_NODES; node++)
+        if (perNode[node]) printf(", node %d %.1f%%", node, 100.0 * perNode[node] / pages);
+    if (elsewhere) printf(", not resident %.1f%%", 100.0 * elsewhere / pages);
+    printf("\n");
+}
+
+// Allocate a flattened score array on huge pages when the system has them,
+// page-aligned and untouched, see seq_alloc.h
+seq_buffer allocateScoreArray(size_t sizeA, size_t sizeB) {
+    return seq_buffer_alloc((size_t)(sizeA + 1) * (sizeB + 1) * sizeof(mtype));
+}
+
+// Initialize the score array to zero. Every full antidiagonal of LCS_Parallel
+// splits rows 1..sizeB over the threads the same static way, so each thread
+// zeroes, and by first touch places on its own node, the rows it computes
+void initScoreArray(mtype *scoreArray, size_t sizeA, size_t sizeB) {
+    size_t rowBytes = (sizeA + 1) * sizeof(mtype);
+#pragma omp parallel for schedule(static)
+    for (size_t a = 1; a <= sizeB; a++) memset(&SCORE(a, 0), 0, rowBytes);
+    memset(scoreArray, 0, rowBytes);
+}
+
+#ifdef LCS_PERF
+// Opens and enables counters on every thread of the team. libgomp keeps the
+// same threads from one parallel region to the next, so they count
+// everything the threads do until perfStop, barrier waits included
+seq_perf_counters *perfStart(void) {
+    seq_perf_counters *perf = calloc(omp_get_max_threads(), sizeof(seq_perf_counters));
+    if (!perf) {
+        fprintf(stderr, "Error allocating memory for perf counters\n");
         exit(EXIT_FAILURE);
     }
-    int i = 0;
-    int c;
-    while ((c = fgetc(fseq)) != EOF) {
-        if (c == '\n') continue;
-        seq[i++] = (char)c;
+#pragma omp parallel
+    {
+        seq_perf_open(&perf[omp_get_thread_num()]);
+        seq_perf_enable(&perf[omp_get_thread_num()]);
     }
-    seq[i] = '\0';
-    fclose(fseq);
-    return seq;
+    return perf;
 }
 
-// Allocate a flattened score array with SIMD-friendly alignment
-mtype *allocateScoreArray(size_t sizeA, size_t sizeB) {
-    mtype *scoreArray;
-    size_t total = (size_t)(sizeA + 1) * (sizeB + 1) * sizeof(mtype);
-    if (posix_memalign((void **)&scoreArray, 64, total) != 0) {
-        fprintf(stderr, "Error in posix_memalign for scoreArray\n");
+// Stops the counters of every thread and prints them with their total
+void perfStop(seq_perf_counters *perf) {
+    int threads = omp_get_max_threads();
+#pragma omp parallel
+    {
+        seq_perf_disable(&perf[omp_get_thread_num()]);
+        seq_perf_close(&perf[omp_get_thread_num()]);
+    }
+    seq_perf_counters total = {{0}};
+    char label[32];
+    for (int t = 0; t < threads; t++) {
+        snprintf(label, sizeof(label), "Perf thread %d", t);
+        seq_perf_print(stdout, label, &perf[t]);
+        seq_perf_add(&total, &perf[t]);
+    }
+    seq_perf_print(stdout, "Perf total", &total);
+    free(perf);
+}
+#endif
+
+#ifdef LCS_TRACE
+// Timeline buffers, one per thread of the team, NULL while nothing is traced
+// so autotuning runs stay out of the trace
+seq_trace_buffer *traceBuffers = NULL;
+
+void traceStart(void) {
+    traceBuffers = calloc(omp_get_max_threads(), sizeof(seq_trace_buffer));
+    if (!traceBuffers) {
+        fprintf(stderr, "Error allocating memory for trace buffers\n");
         exit(EXIT_FAILURE);
     }
-    return scoreArray;
 }
 
-// Initialize the score array to zero
-void initScoreArray(mtype *scoreArray, size_t sizeA, size_t sizeB) {
-    memset(scoreArray, 0, (size_t)(sizeA + 1) * (sizeB + 1) * sizeof(mtype));
+// Writes the buffers of every thread to the trace file, time zero at start
+void traceFinish(uint64_t start) {
+    seq_trace_file file;
+    const char *path = seq_trace_path();
+    int threads = omp_get_max_threads();
+    if (seq_trace_begin_file(&file, path)) {
+        char name[32];
+        for (int t = 0; t < threads; t++) {
+            snprintf(name, sizeof(name), "thread %d", t);
+            seq_trace_write_names(&file, 0, "omp_lcs", t, name);
+            seq_trace_write_events(&file, 0, t, traceBuffers[t].events, traceBuffers[t].count, 0,
+                                   start);
+        }
+        seq_trace_end_file(&file);
+        printf("Trace: %s\n", path);
+    }
+    for (int t = 0; t < threads; t++) seq_trace_free(&traceBuffers[t]);
+    free(traceBuffers);
+    traceBuffers = NULL;
 }
+#endif
 
-// Parallel LCS using anti-diagonal iteration
-int LCS_Parallel(mtype *restrict scoreArray, size_t sizeA, size_t sizeB, const char *restrict seqA,
-                 const char *restrict seqB) {
+// Parallel LCS using anti-diagonal iteration. A is read through its match
+// profile and B packed, see seq_encode.h
+int LCS_Parallel(mtype *restrict scoreArray, size_t sizeA, size_t sizeB,
+                 const uint64_t *restrict profileA, const uint8_t *restrict packedB, int bits) {
+#ifdef LCS_PERF
+    seq_perf_counters *perf = perfStart();
+#endif
     double start_lcs = omp_get_wtime();
     double parallel_time = 0.0;
+    size_t words = seq_profile_words(sizeA);
 
 #ifdef DEBUGSTEPS
-    printf("\nA: %s (%d)\nB: %s (%d)\n\n", seqA, sizeA, seqB, sizeB);
+    printf("\nA: (%zu)\nB: (%zu)\n\n", sizeA, sizeB);
 #endif
 
     // The outer loop iterates sequentially through each antidiagonal
@@ -76,28 +540,908 @@ int LCS_Parallel(mtype *restrict scoreArray, size_t sizeA, size_t sizeB, const c
 #endif
 
         double start_parallel = omp_get_wtime();
-#pragma omp parallel for schedule(static)
-        // The inner loop iterates through each element of the current antidiagonal parallelly
-        for (int a = a_min; a <= a_max; ++a) {
-            int b = d - a;
+#pragma omp parallel
+        {
+#ifdef LCS_TRACE
+            uint64_t start_thread = seq_trace_now();
+#endif
+#pragma omp for schedule(static) nowait
+            // The inner loop iterates through each element of the current antidiagonal parallelly
+            for (int a = a_min; a <= a_max; ++a) {
+                int b = d - a;
 
 #ifdef DEBUGSTEPS
-            printf("  [Thread %d] (a=%d, b=%d)\n", omp_get_thread_num(), a, b);
+                printf("  [Thread %d] (a=%d, b=%d)\n", omp_get_thread_num(), a, b);
+#endif
+
+                const uint64_t *match = profileA + seq_packed_code(packedB, bits, a - 1) * words;
+                if ((match[(b - 1) / 64] >> ((b - 1) % 64)) & 1) {
+                    SCORE(a, b) = SCORE(a - 1, b - 1) + 1;
+                } else {
+                    mtype up = SCORE(a - 1, b);
+                    mtype left = SCORE(a, b - 1);
+                    SCORE(a, b) = up > left ? up : left;
+                }
+            }
+#ifdef LCS_TRACE
+            // the barrier is the idle time of threads done early with this antidiagonal
+            if (traceBuffers) {
+                seq_trace_buffer *buffer = &traceBuffers[omp_get_thread_num()];
+                seq_trace_record(buffer, SEQ_TRACE_COMPUTE, start_thread, d);
+                uint64_t start_wait = seq_trace_now();
+#pragma omp barrier
+                seq_trace_record(buffer, SEQ_TRACE_WAIT, start_wait, d);
+            }
 #endif
+        }
+
+        double end_parallel = omp_get_wtime();
+        parallel_time += (end_parallel - start_parallel);
+    }
+
+    double end_lcs = omp_get_wtime();
+    double total_lcs_time = end_lcs - start_lcs;
+    double sequential_overhead = total_lcs_time - parallel_time;
+
+    printf("Total time: %.6fs\n", total_lcs_time);
+    printf("Parallel time: %.6fs\n", parallel_time);
+    printf("Sequential time: %.6fs\n", sequential_overhead);
+#ifdef LCS_PERF
+    perfStop(perf);
+#endif
+
+    return SCORE(sizeB, sizeA);
+}
+
+// Score-only parallel LCS keeping just the last three antidiagonals.
+// Each antidiagonal buffer is indexed by the row a, so memory is
+// O(min(sizeA, sizeB)) and up/left/diagonal are neighbours in two buffers.
+int LCS_Parallel_Linear(size_t sizeA, size_t sizeB, const char *seqA, const char *seqB) {
+    double start_lcs = omp_get_wtime();
+    double parallel_time = 0.0;
+
+    // the recurrence is symmetric, let the shorter sequence index the rows
+    if (sizeB > sizeA) {
+        const char *seqTmp = seqA;
+        size_t sizeTmp = sizeA;
+        seqA = seqB;
+        sizeA = sizeB;
+        seqB = seqTmp;
+        sizeB = sizeTmp;
+    }
+
+    // three zeroed antidiagonals, rotated every step. Cells with a == 0 or
+    // b == 0 are never written, so the borders read back as zero
+    mtype *diagBuffer;
+    if (posix_memalign((void **)&diagBuffer, 64, 3 * (sizeB + 1) * sizeof(mtype)) != 0) {
+        fprintf(stderr, "Error in posix_memalign for antidiagonals\n");
+        exit(EXIT_FAILURE);
+    }
+    memset(diagBuffer, 0, 3 * (sizeB + 1) * sizeof(mtype));
+    mtype *prev2 = diagBuffer;
+    mtype *prev1 = diagBuffer + (sizeB + 1);
+    mtype *curr = diagBuffer + 2 * (sizeB + 1);
+
+    // seqA[b - 1] with b = d - a is revA[sizeA + a - d], unit stride in a
+    char *revA = malloc(sizeA + 1);
+    if (!revA) {
+        fprintf(stderr, "Error allocating memory for reversed sequence\n");
+        exit(EXIT_FAILURE);
+    }
+    for (size_t j = 0; j < sizeA; j++) revA[j] = seqA[sizeA - 1 - j];
+
+    int num_diag = sizeA + sizeB;  // number of antidiaginals
+    for (int d = 2; d <= num_diag; ++d) {
+        int a_min = d > sizeA + 1 ? d - sizeA : 1;
+        int a_max = (d - 1) < sizeB ? (d - 1) : sizeB;
+
+        double start_parallel = omp_get_wtime();
+        updateAntidiagonal(curr, prev1, prev2, seqB, revA + (sizeA + a_min - d), a_min, a_max);
+        double end_parallel = omp_get_wtime();
+        parallel_time += (end_parallel - start_parallel);
+
+        mtype *tmp = prev2;
+        prev2 = prev1;
+        prev1 = curr;
+        curr = tmp;
+    }
+
+    int score = prev1[sizeB];
+    free(diagBuffer);
+    free(revA);
+
+    double end_lcs = omp_get_wtime();
+    double total_lcs_time = end_lcs - start_lcs;
+    double sequential_overhead = total_lcs_time - parallel_time;
+
+    printf("Total time: %.6fs\n", total_lcs_time);
+    printf("Parallel time: %.6fs\n", parallel_time);
+    printf("Sequential time: %.6fs\n", sequential_overhead);
+
+    return score;
+}
+
+// Computes the tile rows [row0, row1] x columns [col0, col1]. top holds the row
+// above the tile with the top-left corner in top[0], left holds column col0 - 1
+// indexed by row. Both are updated in place: top becomes the bottom row, with
+// the last value of the left column as the corner of the tile below, and left
+// becomes the right column for the tile on the right
+void computeTile(const char *seqA, const char *seqB, size_t row0, size_t row1, size_t col0,
+                 size_t col1, mtype *restrict top, mtype *restrict left) {
+    size_t width = col1 - col0 + 1;
+    const char *tileA = seqA + col0 - 1;
+    for (size_t i = row0; i <= row1; i++) {
+        char b = seqB[i - 1];
+        mtype diag = top[0];
+        mtype value = left[i];
+        top[0] = value;
+        for (size_t c = 1; c <= width; c++) {
+            mtype up = top[c];
+            if (tileA[c - 1] == b) {
+                value = diag + 1;
+            } else {
+                value = up > value ? up : value;
+            }
+            diag = up;
+            top[c] = value;
+        }
+        left[i] = value;
+    }
+}
+
+// Tiled wavefront shared by LCS_Parallel_Tiled and the autotuner. Every
+// tile.height x tile.width tile is an OpenMP task that depends on the tiles
+// above and to the left, so a tile starts as soon as its neighbours are done
+// instead of waiting on a barrier per antidiagonal. Only the bottom row of each
+// column of tiles and the right column of each row of tiles are kept,
+// O(sizeA + sizeB) memory. Stores the time of the parallel region in parallelTime.
+// With checkpoints the antidiagonals run in epochs of checkpoint.interval: at
+// the end of an epoch those borders are the whole state of the run, a copy of
+// them is handed to a writer task and the next epoch starts right away
+int tiledWavefront(size_t sizeA, size_t sizeB, const char *seqA, const char *seqB,
+                   tileShape tile, double *parallelTime) {
+    *parallelTime = 0;
+    if (sizeA == 0 || sizeB == 0) return 0;
+
+    size_t rowTiles = (sizeB + tile.height - 1) / tile.height;
+    size_t colTiles = (sizeA + tile.width - 1) / tile.width;
+    size_t diagonals = rowTiles + colTiles - 1;
+
+    // bottom rows, tile.width + 1 values per column of tiles (corner first),
+    // followed by the right columns indexed by row. All zero, which is the top
+    // and left border
+    size_t frontierCells = colTiles * (tile.width + 1) + sizeB + 1;
+    mtype *rowBorders = calloc(frontierCells, sizeof(mtype));
+    mtype *colBorder = rowBorders + colTiles * (tile.width + 1);
+    // dependency sentinels, one per tile
+    char *tileDone = calloc(rowTiles * colTiles, sizeof(char));
+    if (!rowBorders || !tileDone) {
+        fprintf(stderr, "Error allocating memory for tile borders\n");
+        exit(EXIT_FAILURE);
+    }
+    char border = 0;  // never written, stands in for tiles outside the matrix
+
+    // resume from the last snapshot of this input and tile shape, if any
+    size_t firstDiagonal = 0;
+    seq_checkpoint_header header;
+    mtype *snapshots[2] = {NULL, NULL};
+    if (checkpoint.path) {
+        header = seq_checkpoint_header_of(seqA, sizeA, sizeA, seqB, sizeB, sizeB, tile.height,
+                                          tile.width);
+        firstDiagonal = seq_checkpoint_load(checkpoint.path, &header, rowBorders,
+                                            frontierCells * sizeof(mtype));
+        if (firstDiagonal == 0 || firstDiagonal >= diagonals) {
+            memset(rowBorders, 0, frontierCells * sizeof(mtype));
+            firstDiagonal = 0;
+        } else {
+            printf("Resumed at tile antidiagonal %zu of %zu\n", firstDiagonal, diagonals);
+        }
+        snapshots[0] = malloc(frontierCells * sizeof(mtype));
+        snapshots[1] = malloc(frontierCells * sizeof(mtype));
+        if (!snapshots[0] || !snapshots[1]) {
+            fprintf(stderr, "Error allocating memory for checkpoints\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    size_t epoch = checkpoint.path ? checkpoint.interval : diagonals;
+
+    double start_parallel = omp_get_wtime();
+#pragma omp parallel
+#pragma omp single
+    {
+        for (size_t d0 = firstDiagonal, e = 0; d0 < diagonals; d0 += epoch, e++) {
+            size_t d1 = d0 + epoch < diagonals ? d0 + epoch : diagonals;
+
+#pragma omp taskgroup
+            {
+                // tasks are created antidiagonal by antidiagonal so the ready ones come first
+                for (size_t d = d0; d < d1; d++) {
+                    size_t ti_min = d >= colTiles ? d - colTiles + 1 : 0;
+                    size_t ti_max = d < rowTiles ? d : rowTiles - 1;
+                    for (size_t ti = ti_min; ti <= ti_max; ti++) {
+                        size_t tj = d - ti;
+                        char *self = &tileDone[ti * colTiles + tj];
+                        char *up = ti > 0 ? &tileDone[(ti - 1) * colTiles + tj] : &border;
+                        char *left = tj > 0 ? &tileDone[ti * colTiles + tj - 1] : &border;
+
+#pragma omp task firstprivate(ti, tj) depend(in : *up, *left) depend(out : *self)
+                        {
+#ifdef LCS_TRACE
+                            uint64_t start_tile = seq_trace_now();
+#endif
+                            size_t row0 = ti * tile.height + 1;
+                            size_t row1 =
+                                (ti + 1) * tile.height < sizeB ? (ti + 1) * tile.height : sizeB;
+                            size_t col0 = tj * tile.width + 1;
+                            size_t col1 =
+                                (tj + 1) * tile.width < sizeA ? (tj + 1) * tile.width : sizeA;
+                            computeTile(seqA, seqB, row0, row1, col0, col1,
+                                        rowBorders + tj * (tile.width + 1), colBorder);
+#ifdef LCS_TRACE
+                            if (traceBuffers)
+                                seq_trace_record(&traceBuffers[omp_get_thread_num()],
+                                                 SEQ_TRACE_COMPUTE, start_tile, d);
+#endif
+                        }
+                    }
+                }
+            }
+
+            if (checkpoint.path && d1 < diagonals) {
+                // the buffer is free once the write from two epochs ago is done
+                mtype *snapshot = snapshots[e % 2];
+#pragma omp taskwait depend(inout : *snapshot)
+                memcpy(snapshot, rowBorders, frontierCells * sizeof(mtype));
+                seq_checkpoint_header snapshotHeader = header;
+                snapshotHeader.diagonal = d1;
+
+                // writers also depend on the pair of buffers, so they share the
+                // temporary file one at a time and in epoch order
+#pragma omp task firstprivate(snapshot, snapshotHeader) depend(inout : *snapshot, snapshots)
+                {
+#ifdef LCS_TRACE
+                    uint64_t start_write = seq_trace_now();
+#endif
+                    if (!seq_checkpoint_replace(checkpoint.path, &snapshotHeader, snapshot,
+                                                frontierCells * sizeof(mtype)))
+                        fprintf(stderr, "Warning: could not write checkpoint %s\n",
+                                checkpoint.path);
+#ifdef LCS_TRACE
+                    if (traceBuffers)
+                        seq_trace_record(&traceBuffers[omp_get_thread_num()],
+                                         SEQ_TRACE_CHECKPOINT, start_write, (int)d1);
+#endif
+                }
+            }
+        }
+    }
+    *parallelTime = omp_get_wtime() - start_parallel;
+
+    // the last tile leaves the bottom right cell at the end of its bottom row
+    size_t lastWidth = sizeA - (colTiles - 1) * tile.width;
+    int score = rowBorders[(colTiles - 1) * (tile.width + 1) + lastWidth];
+
+    free(rowBorders);
+    free(tileDone);
+    free(snapshots[0]);
+    free(snapshots[1]);
+
+    return score;
+}
+
+// Tiled parallel LCS, see tiledWavefront
+int LCS_Parallel_Tiled(size_t sizeA, size_t sizeB, const char *seqA, const char *seqB,
+                       tileShape tile) {
+#ifdef LCS_PERF
+    seq_perf_counters *perf = perfStart();
+#endif
+    double start_lcs = omp_get_wtime();
+
+    double parallel_time;
+    int score = tiledWavefront(sizeA, sizeB, seqA, seqB, tile, &parallel_time);
+
+    double total_lcs_time = omp_get_wtime() - start_lcs;
+    printf("Total time: %.6fs\n", total_lcs_time);
+    printf("Parallel time: %.6fs\n", parallel_time);
+    printf("Sequential time: %.6fs\n", total_lcs_time - parallel_time);
+#ifdef LCS_PERF
+    perfStop(perf);
+#endif
+
+    return score;
+}
+
+// Number of column tiles a band of rows has finished, alone on its cache line
+// so publishing progress never invalidates a neighbour's counter
+typedef struct {
+    int chunks;
+    char pad[64 - sizeof(int)];
+} bandProgress;
+
+// Waits until band has finished more than chunk column tiles. seen caches the
+// last value read so the counter is only touched when the band is behind
+void waitForBand(bandProgress *band, int chunk, int *seen) {
+    int spins = 0;
+    while (*seen <= chunk) {
+#pragma omp atomic read acquire
+        *seen = band->chunks;
+        if (*seen > chunk) break;
+#if defined(__x86_64__) || defined(__i386__)
+        _mm_pause();
+#endif
+        if (++spins == SPIN_BEFORE_YIELD) {
+            spins = 0;
+            sched_yield();
+        }
+    }
+}
+
+// Pipelined wavefront on one persistent thread team, shared by
+// LCS_Parallel_Pipeline and the autotuner. Rows are cut into bands of
+// tile.height owned round-robin by the threads; a band walks its column tiles
+// of tile.width left to right and, after each tile, publishes how far it got.
+// The band below only waits on that counter, so there is a single parallel
+// region and no barrier or lock at all
+int pipelineWavefront(size_t sizeA, size_t sizeB, const char *seqA, const char *seqB,
+                      tileShape tile, double *parallelTime) {
+    *parallelTime = 0;
+    if (sizeA == 0 || sizeB == 0) return 0;
 
+    size_t rowBands = (sizeB + tile.height - 1) / tile.height;
+    size_t colTiles = (sizeA + tile.width - 1) / tile.width;
+
+    // same border layout as the tiled engine
+    mtype *rowBorders = calloc(colTiles * (tile.width + 1), sizeof(mtype));
+    mtype *colBorder = calloc(sizeB + 1, sizeof(mtype));
+    bandProgress *progress;
+    if (!rowBorders || !colBorder ||
+        posix_memalign((void **)&progress, 64, rowBands * sizeof(bandProgress)) != 0) {
+        fprintf(stderr, "Error allocating memory for band borders\n");
+        exit(EXIT_FAILURE);
+    }
+    memset(progress, 0, rowBands * sizeof(bandProgress));
+
+    double start_parallel = omp_get_wtime();
+#pragma omp parallel
+    {
+        size_t nthreads = omp_get_num_threads();
+        for (size_t band = omp_get_thread_num(); band < rowBands; band += nthreads) {
+            size_t row0 = band * tile.height + 1;
+            size_t row1 = (band + 1) * tile.height < sizeB ? (band + 1) * tile.height : sizeB;
+            int seen = band > 0 ? 0 : (int)colTiles;
+
+            for (size_t tj = 0; tj < colTiles; tj++) {
+                // the bottom row of this tile column must come from the band above
+                if (band > 0) waitForBand(&progress[band - 1], tj, &seen);
+
+                size_t col0 = tj * tile.width + 1;
+                size_t col1 = (tj + 1) * tile.width < sizeA ? (tj + 1) * tile.width : sizeA;
+                computeTile(seqA, seqB, row0, row1, col0, col1, rowBorders + tj * (tile.width + 1),
+                            colBorder);
+
+#pragma omp atomic write release
+                progress[band].chunks = tj + 1;
+            }
+        }
+    }
+    *parallelTime = omp_get_wtime() - start_parallel;
+
+    size_t lastWidth = sizeA - (colTiles - 1) * tile.width;
+    int score = rowBorders[(colTiles - 1) * (tile.width + 1) + lastWidth];
+
+    free(rowBorders);
+    free(colBorder);
+    free(progress);
+
+    return score;
+}
+
+// Pipelined parallel LCS, see pipelineWavefront
+int LCS_Parallel_Pipeline(size_t sizeA, size_t sizeB, const char *seqA, const char *seqB,
+                          tileShape tile) {
+    double start_lcs = omp_get_wtime();
+
+    double parallel_time;
+    int score = pipelineWavefront(sizeA, sizeB, seqA, seqB, tile, &parallel_time);
+
+    double total_lcs_time = omp_get_wtime() - start_lcs;
+    printf("Total time: %.6fs\n", total_lcs_time);
+    printf("Parallel time: %.6fs\n", parallel_time);
+    printf("Sequential time: %.6fs\n", total_lcs_time - parallel_time);
+
+    return score;
+}
+
+// Difference-encoded tile of the bit engine: rows [row0, row1) of seqB over
+// the words [word0, word1) of the row bits. carries holds one bit per row, the
+// difference carried in from the tile on the left, and is replaced by the one
+// carried out to the tile on the right
+void bitTile(const uint64_t *masks, const unsigned char *symbol, size_t words, const char *seqB,
+             size_t row0, size_t row1, size_t word0, size_t word1, uint64_t *restrict rowBits,
+             uint64_t *restrict carries) {
+    for (size_t i = row0; i < row1; i++) {
+        const uint64_t *match = masks + symbol[(unsigned char)seqB[i]] * words;
+        uint64_t carry = (carries[i / 64] >> (i % 64)) & 1;
+        for (size_t w = word0; w < word1; w++) {
+            uint64_t v = rowBits[w];
+            uint64_t u = v & match[w];
+            uint64_t sum;
+            // V' = (V + U) | (V - U); U is a subset of V so V - U never borrows
+            uint64_t c1 = __builtin_add_overflow(v, u, &sum);
+            uint64_t c2 = __builtin_add_overflow(sum, carry, &sum);
+            carry = c1 | c2;
+            rowBits[w] = sum | (v & ~u);
+        }
+        carries[i / 64] = (carries[i / 64] & ~((uint64_t)1 << (i % 64))) | (carry << (i % 64));
+    }
+}
+
+// Difference-encoded tiled wavefront. Neighbouring cells differ by 0 or 1, so
+// a row is kept as one bit per column (set where it does not grow, as in the
+// bit-parallel engine of seq_lcs) and a tile boundary as one bit per row: the
+// carry of the row update, which is the vertical difference at that column.
+// Tiles are tasks as in the tiled engine, with both edges rounded up to 64 so
+// a tile owns whole words of both bit vectors. The score is the number of
+// cleared row bits, exact at any length, and the state is sizeA + sizeB bits
+int bitWavefront(size_t sizeA, size_t sizeB, const char *seqA, const char *seqB, tileShape tile,
+                 double *parallelTime) {
+    *parallelTime = 0;
+    if (sizeA == 0 || sizeB == 0) return 0;
+
+    size_t words = (sizeA + 63) / 64;
+    size_t tileWords = (tile.width + 63) / 64;
+    size_t bandRows = (tile.height + 63) / 64 * 64;
+    size_t rowTiles = (sizeB + bandRows - 1) / bandRows;
+    size_t colTiles = (words + tileWords - 1) / tileWords;
+
+    // give every symbol of A its own mask slot, slot 0 stays empty
+    unsigned char symbol[256] = {0};
+    size_t numSymbols = 0;
+    for (size_t j = 0; j < sizeA; j++) {
+        unsigned char c = (unsigned char)seqA[j];
+        if (symbol[c] == 0) symbol[c] = ++numSymbols;
+    }
+
+    uint64_t *masks = calloc((numSymbols + 1) * words, sizeof(uint64_t));
+    uint64_t *rowBits = malloc(words * sizeof(uint64_t));
+    uint64_t *carries = calloc(rowTiles * bandRows / 64, sizeof(uint64_t));
+    char *tileDone = calloc(rowTiles * colTiles, sizeof(char));
+    if (!masks || !rowBits || !carries || !tileDone) {
+        fprintf(stderr, "Error allocating memory for bit vectors\n");
+        exit(EXIT_FAILURE);
+    }
+    for (size_t j = 0; j < sizeA; j++)
+        masks[symbol[(unsigned char)seqA[j]] * words + j / 64] |= (uint64_t)1 << (j % 64);
+    // row 0 never grows, and nothing is carried in from column 0
+    memset(rowBits, 0xff, words * sizeof(uint64_t));
+    char border = 0;
+
+    double start_parallel = omp_get_wtime();
+#pragma omp parallel
+#pragma omp single
+    {
+        for (size_t d = 0; d < rowTiles + colTiles - 1; d++) {
+            size_t ti_min = d >= colTiles ? d - colTiles + 1 : 0;
+            size_t ti_max = d < rowTiles ? d : rowTiles - 1;
+            for (size_t ti = ti_min; ti <= ti_max; ti++) {
+                size_t tj = d - ti;
+                char *self = &tileDone[ti * colTiles + tj];
+                char *up = ti > 0 ? &tileDone[(ti - 1) * colTiles + tj] : &border;
+                char *left = tj > 0 ? &tileDone[ti * colTiles + tj - 1] : &border;
+
+#pragma omp task firstprivate(ti, tj) depend(in : *up, *left) depend(out : *self)
+                {
+                    size_t row1 = (ti + 1) * bandRows < sizeB ? (ti + 1) * bandRows : sizeB;
+                    size_t word1 = (tj + 1) * tileWords < words ? (tj + 1) * tileWords : words;
+                    bitTile(masks, symbol, words, seqB, ti * bandRows, row1, tj * tileWords,
+                            word1, rowBits, carries);
+                }
+            }
+        }
+    }
+    *parallelTime = omp_get_wtime() - start_parallel;
+
+    // count the zero bits inside the first sizeA positions
+    size_t score = 0;
+    for (size_t w = 0; w < words; w++) {
+        uint64_t valid = ~(uint64_t)0;
+        if (w == words - 1 && sizeA % 64 != 0) valid = ((uint64_t)1 << (sizeA % 64)) - 1;
+        score += __builtin_popcountll(~rowBits[w] & valid);
+    }
+
+    free(masks);
+    free(rowBits);
+    free(carries);
+    free(tileDone);
+
+    return (int)score;
+}
+
+// Difference-encoded parallel LCS, see bitWavefront
+int LCS_Parallel_Bits(size_t sizeA, size_t sizeB, const char *seqA, const char *seqB,
+                      tileShape tile) {
+    double start_lcs = omp_get_wtime();
+
+    double parallel_time;
+    int score = bitWavefront(sizeA, sizeB, seqA, seqB, tile, &parallel_time);
+
+    double total_lcs_time = omp_get_wtime() - start_lcs;
+    printf("Total time: %.6fs\n", total_lcs_time);
+    printf("Parallel time: %.6fs\n", parallel_time);
+    printf("Sequential time: %.6fs\n", total_lcs_time - parallel_time);
+
+    return score;
+}
+
+typedef int (*tileEngineFn)(size_t, size_t, const char *, const char *, tileShape, double *);
+
+// Runs engine on the first AUTOTUNE_PREFIX characters of both sequences with
+// every pair of candidate height and width and returns the fastest shape.
+// widthScale stretches the candidate widths and the prefix of A for engines
+// that do more than one column per operation
+tileShape autotuneTile(tileEngineFn engine, size_t widthScale, size_t sizeA, size_t sizeB,
+                       const char *seqA, const char *seqB) {
+    size_t prefixA = sizeA < AUTOTUNE_PREFIX * widthScale ? sizeA : AUTOTUNE_PREFIX * widthScale;
+    size_t prefixB = sizeB < AUTOTUNE_PREFIX ? sizeB : AUTOTUNE_PREFIX;
+    size_t candidates = sizeof(tileCandidates) / sizeof(tileCandidates[0]);
+    tileShape best = {TILE_SIZE, TILE_SIZE};
+    double bestTime = -1;
+
+    for (size_t h = 0; h < candidates; h++) {
+        for (size_t w = 0; w < candidates; w++) {
+            tileShape tile = {tileCandidates[h], tileCandidates[w] * widthScale};
+            double time;
+            engine(prefixA, prefixB, seqA, seqB, tile, &time);
+            if (bestTime < 0 || time < bestTime) {
+                bestTime = time;
+                best = tile;
+            }
+        }
+    }
+    return best;
+}
+
+// Parses -t HxW, or a single edge for square tiles
+int parseTileShape(const char *text, tileShape *tile) {
+    size_t height, width;
+    int fields = sscanf(text, "%zux%zu", &height, &width);
+    if (fields == 1) width = height;
+    else if (fields != 2) return 0;
+    if (height == 0 || width == 0) return 0;
+    tile->height = height;
+    tile->width = width;
+    return 1;
+}
+
+// Last row of the LCS table of seqA (columns) against seqB (rows), one rolling row
+void lcsLastRow(const char *seqA, size_t sizeA, const char *seqB, size_t sizeB, mtype *row) {
+    memset(row, 0, (sizeA + 1) * sizeof(mtype));
+    for (size_t i = 0; i < sizeB; i++) {
+        mtype diag = 0;
+        for (size_t j = 1; j <= sizeA; j++) {
+            mtype up = row[j];
+            if (seqA[j - 1] == seqB[i]) {
+                row[j] = diag + 1;
+            } else {
+                row[j] = up > row[j - 1] ? up : row[j - 1];
+            }
+            diag = up;
+        }
+    }
+}
+
+// Same as lcsLastRow, but sweeping antidiagonals with a parallel for. The cell
+// (sizeB, b) is copied out when its antidiagonal d = sizeB + b is done
+void lcsLastRowParallel(const char *seqA, size_t sizeA, const char *seqB, size_t sizeB,
+                        mtype *row) {
+    mtype *diagBuffer = calloc(3 * (sizeB + 1), sizeof(mtype));
+    if (!diagBuffer) {
+        fprintf(stderr, "Error allocating memory for antidiagonals\n");
+        exit(EXIT_FAILURE);
+    }
+    mtype *prev2 = diagBuffer;
+    mtype *prev1 = diagBuffer + (sizeB + 1);
+    mtype *curr = diagBuffer + 2 * (sizeB + 1);
+
+    row[0] = 0;
+    int num_diag = sizeA + sizeB;
+    for (int d = 2; d <= num_diag; ++d) {
+        int a_min = d > sizeA + 1 ? d - sizeA : 1;
+        int a_max = (d - 1) < sizeB ? (d - 1) : sizeB;
+
+#pragma omp parallel for schedule(static)
+        for (int a = a_min; a <= a_max; ++a) {
+            int b = d - a;
             if (seqB[a - 1] == seqA[b - 1]) {
-                SCORE(a, b) = SCORE(a - 1, b - 1) + 1;
+                curr[a] = prev2[a - 1] + 1;
             } else {
-                mtype up = SCORE(a - 1, b);
-                mtype left = SCORE(a, b - 1);
-                SCORE(a, b) = up > left ? up : left;
+                mtype up = prev1[a - 1];
+                mtype left = prev1[a];
+                curr[a] = up > left ? up : left;
             }
         }
+        if (a_max == sizeB) row[d - sizeB] = curr[sizeB];
+
+        mtype *tmp = prev2;
+        prev2 = prev1;
+        prev1 = curr;
+        curr = tmp;
+    }
+    free(diagBuffer);
+}
 
+// Full table traceback for small subproblems, returns the LCS length
+size_t lcsSmall(const char *seqA, size_t sizeA, const char *seqB, size_t sizeB, char *out) {
+    mtype *table = calloc((sizeA + 1) * (sizeB + 1), sizeof(mtype));
+    if (!table) {
+        fprintf(stderr, "Error allocating memory for traceback table\n");
+        exit(EXIT_FAILURE);
+    }
+#define CELL(i, j) table[(size_t)(i) * (sizeA + 1) + (j)]
+    for (size_t i = 1; i <= sizeB; i++) {
+        for (size_t j = 1; j <= sizeA; j++) {
+            if (seqA[j - 1] == seqB[i - 1]) {
+                CELL(i, j) = CELL(i - 1, j - 1) + 1;
+            } else {
+                CELL(i, j) = CELL(i - 1, j) > CELL(i, j - 1) ? CELL(i - 1, j) : CELL(i, j - 1);
+            }
+        }
+    }
+
+    // walk back from the bottom right corner, filling the output from its end
+    size_t length = CELL(sizeB, sizeA);
+    size_t k = length;
+    size_t i = sizeB, j = sizeA;
+    while (i > 0 && j > 0) {
+        if (seqA[j - 1] == seqB[i - 1]) {
+            out[--k] = seqA[j - 1];
+            i--;
+            j--;
+        } else if (CELL(i - 1, j) >= CELL(i, j - 1)) {
+            i--;
+        } else {
+            j--;
+        }
+    }
+#undef CELL
+    free(table);
+    return length;
+}
+
+// Sequences of a Hirschberg traceback along with reversed copies, so the
+// suffix rows of any subproblem are plain forward rows over the copies
+typedef struct {
+    const char *seqA, *seqB;
+    char *revA, *revB;
+    size_t sizeA, sizeB;
+} hirschbergCtx;
+
+// A subproblem A[a0, a0 + na) x B[b0, b0 + nb) whose LCS goes to out
+typedef struct {
+    size_t a0, na, b0, nb;
+    char *out;
+} hirschbergJob;
+
+// Splits B in half and finds the column k where the optimal path crosses the
+// middle row. Returns the LCS length of the subproblem, *top gets the share
+// of the upper half
+size_t hirschbergSplit(const hirschbergCtx *ctx, const hirschbergJob *job, int parallelRows,
+                       size_t *k, size_t *top) {
+    size_t mid = job->nb / 2;
+    const char *subA = ctx->seqA + job->a0;
+    const char *subB = ctx->seqB + job->b0;
+    const char *revA = ctx->revA + (ctx->sizeA - job->a0 - job->na);
+    const char *revB = ctx->revB + (ctx->sizeB - job->b0 - job->nb);
+
+    mtype *forward = malloc((job->na + 1) * sizeof(mtype));
+    mtype *backward = malloc((job->na + 1) * sizeof(mtype));
+    if (!forward || !backward) {
+        fprintf(stderr, "Error allocating memory for Hirschberg rows\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (parallelRows) {
+        lcsLastRowParallel(subA, job->na, subB, mid, forward);
+        lcsLastRowParallel(revA, job->na, revB, job->nb - mid, backward);
+    } else if (job->na * job->nb > HIRSCHBERG_TASK_CELLS) {
+#pragma omp task shared(forward)
+        lcsLastRow(subA, job->na, subB, mid, forward);
+#pragma omp task shared(backward)
+        lcsLastRow(revA, job->na, revB, job->nb - mid, backward);
+#pragma omp taskwait
+    } else {
+        lcsLastRow(subA, job->na, subB, mid, forward);
+        lcsLastRow(revA, job->na, revB, job->nb - mid, backward);
+    }
+
+    size_t best = 0;
+    *k = 0;
+    for (size_t j = 0; j <= job->na; j++) {
+        size_t total = (size_t)forward[j] + backward[job->na - j];
+        if (total > best) {
+            best = total;
+            *k = j;
+        }
+    }
+    *top = forward[*k];
+
+    free(forward);
+    free(backward);
+    return best;
+}
+
+// Task-parallel Hirschberg recursion, both halves run as independent tasks and
+// write to disjoint ranges of the output
+size_t hirschbergTask(const hirschbergCtx *ctx, hirschbergJob job) {
+    if (job.na == 0 || job.nb == 0) return 0;
+    if (job.na <= 1 || job.nb <= 1 || (job.na + 1) * (job.nb + 1) <= HIRSCHBERG_BASE_CELLS)
+        return lcsSmall(ctx->seqA + job.a0, job.na, ctx->seqB + job.b0, job.nb, job.out);
+
+    size_t k, top;
+    size_t length = hirschbergSplit(ctx, &job, 0, &k, &top);
+    size_t mid = job.nb / 2;
+    hirschbergJob upper = {job.a0, k, job.b0, mid, job.out};
+    hirschbergJob lower = {job.a0 + k, job.na - k, job.b0 + mid, job.nb - mid, job.out + top};
+
+    if (job.na * job.nb > HIRSCHBERG_TASK_CELLS) {
+#pragma omp task
+        hirschbergTask(ctx, upper);
+#pragma omp task
+        hirschbergTask(ctx, lower);
+#pragma omp taskwait
+    } else {
+        hirschbergTask(ctx, upper);
+        hirschbergTask(ctx, lower);
+    }
+    return length;
+}
+
+// Top of the recursion: large subproblems are split with parallel antidiagonal
+// sweeps until they are small enough to be handed to the task phase
+void hirschbergSplitLarge(const hirschbergCtx *ctx, hirschbergJob job, hirschbergJob **jobs,
+                          size_t *numJobs, size_t *capacity) {
+    if (job.na == 0 || job.nb == 0) return;
+    if (job.na * job.nb <= HIRSCHBERG_PARALLEL_CELLS || job.nb <= 1) {
+        if (*numJobs == *capacity) {
+            *capacity = *capacity ? 2 * *capacity : 64;
+            *jobs = realloc(*jobs, *capacity * sizeof(hirschbergJob));
+            if (!*jobs) {
+                fprintf(stderr, "Error allocating memory for Hirschberg jobs\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+        (*jobs)[(*numJobs)++] = job;
+        return;
+    }
+
+    size_t k, top;
+    hirschbergSplit(ctx, &job, 1, &k, &top);
+    size_t mid = job.nb / 2;
+    hirschbergJob upper = {job.a0, k, job.b0, mid, job.out};
+    hirschbergJob lower = {job.a0 + k, job.na - k, job.b0 + mid, job.nb - mid, job.out + top};
+    hirschbergSplitLarge(ctx, upper, jobs, numJobs, capacity);
+    hirschbergSplitLarge(ctx, lower, jobs, numJobs, capacity);
+}
+
+// Linear-space LCS reconstruction (Hirschberg). Writes the subsequence to lcs,
+// which must hold min(sizeA, sizeB) + 1 chars, and returns its length
+size_t LCS_Hirschberg(const char *seqA, size_t sizeA, const char *seqB, size_t sizeB, char *lcs) {
+    double start_lcs = omp_get_wtime();
+
+    hirschbergCtx ctx = {seqA, seqB, malloc(sizeA + 1), malloc(sizeB + 1), sizeA, sizeB};
+    if (!ctx.revA || !ctx.revB) {
+        fprintf(stderr, "Error allocating memory for reversed sequences\n");
+        exit(EXIT_FAILURE);
+    }
+    for (size_t j = 0; j < sizeA; j++) ctx.revA[j] = seqA[sizeA - 1 - j];
+    for (size_t i = 0; i < sizeB; i++) ctx.revB[i] = seqB[sizeB - 1 - i];
+
+    hirschbergJob *jobs = NULL;
+    size_t numJobs = 0, capacity = 0;
+    hirschbergJob root = {0, sizeA, 0, sizeB, lcs};
+    hirschbergSplitLarge(&ctx, root, &jobs, &numJobs, &capacity);
+
+    size_t length = 0;
+#pragma omp parallel
+#pragma omp single
+    {
+        for (size_t t = 0; t < numJobs; t++) {
+#pragma omp task firstprivate(t) shared(length)
+            {
+                size_t part = hirschbergTask(&ctx, jobs[t]);
+#pragma omp atomic
+                length += part;
+            }
+        }
+    }
+    lcs[length] = '\0';
+
+    free(jobs);
+    free(ctx.revA);
+    free(ctx.revB);
+
+    printf("Total time: %.6fs\n", omp_get_wtime() - start_lcs);
+    return length;
+}
+
+// Allocate a zeroed antidiagonal-major score store with its offset table
+diagStore allocateDiagStore(size_t sizeA, size_t sizeB) {
+    diagStore store;
+    store.memory = seq_buffer_alloc((size_t)(sizeA + 1) * (sizeB + 1) * sizeof(mtype));
+    store.cells = store.memory.data;
+
+    store.base = malloc((sizeA + sizeB + 1) * sizeof(size_t));
+    if (!store.base) {
+        fprintf(stderr, "Error allocating memory for antidiagonal offsets\n");
+        exit(EXIT_FAILURE);
+    }
+    // antidiagonal d spans a in [max(0, d - sizeA), min(d, sizeB)]
+    size_t offset = 0;
+    for (size_t d = 0; d <= sizeA + sizeB; d++) {
+        size_t low = d > sizeA ? d - sizeA : 0;
+        size_t high = d < sizeB ? d : sizeB;
+        store.base[d] = offset - low;
+        offset += high - low + 1;
+    }
+
+    // every thread zeroes, and so places on its node by first touch, the cells
+    // updateAntidiagonal gives it. The borders a = 0 and b = 0 come after
+#pragma omp parallel
+    for (size_t d = 2; d <= sizeA + sizeB; d++) {
+        size_t a_min = d > sizeA + 1 ? d - sizeA : 1;
+        size_t a_max = (d - 1) < sizeB ? (d - 1) : sizeB;
+        size_t lo, hi;
+        antidiagonalShare(a_max - a_min + 1, omp_get_thread_num(), omp_get_num_threads(), &lo,
+                          &hi);
+        if (hi > lo)
+            memset(store.cells + store.base[d] + a_min + lo, 0, (hi - lo) * sizeof(mtype));
+    }
+    for (size_t d = 0; d <= sizeA + sizeB; d++) {
+        if (d <= sizeA) DSCORE(store, 0, d) = 0;
+        if (d <= sizeB) DSCORE(store, d, 0) = 0;
+    }
+    return store;
+}
+
+void freeDiagStore(diagStore store) {
+    seq_buffer_free(&store.memory);
+    free(store.base);
+}
+
+// Parallel LCS over antidiagonal-major storage. Up and left are consecutive
+// cells of the previous antidiagonal and the diagonal neighbour sits on the one
+// before, so every access of the inner loop is unit-stride. A is read through
+// a reversed copy for the same reason, which lets diagKernel run in SIMD lanes
+int LCS_Parallel_Diagonal(diagStore store, size_t sizeA, size_t sizeB, const char *restrict seqA,
+                          const char *restrict seqB) {
+    double start_lcs = omp_get_wtime();
+    double parallel_time = 0.0;
+
+    // seqA[b - 1] with b = d - a is revA[sizeA + a - d]
+    char *revA = malloc(sizeA + 1);
+    if (!revA) {
+        fprintf(stderr, "Error allocating memory for reversed sequence\n");
+        exit(EXIT_FAILURE);
+    }
+    for (size_t j = 0; j < sizeA; j++) revA[j] = seqA[sizeA - 1 - j];
+
+    int num_diag = sizeA + sizeB;  // number of antidiaginals
+    for (int d = 2; d <= num_diag; ++d) {
+        int a_min = d > sizeA + 1 ? d - sizeA : 1;
+        int a_max = (d - 1) < sizeB ? (d - 1) : sizeB;
+
+        mtype *curr = store.cells + store.base[d];
+        const mtype *prev1 = store.cells + store.base[d - 1];
+        const mtype *prev2 = store.cells + store.base[d - 2];
+
+        double start_parallel = omp_get_wtime();
+        updateAntidiagonal(curr, prev1, prev2, seqB, revA + (sizeA + a_min - d), a_min, a_max);
         double end_parallel = omp_get_wtime();
         parallel_time += (end_parallel - start_parallel);
     }
 
+    free(revA);
+
     double end_lcs = omp_get_wtime();
     double total_lcs_time = end_lcs - start_lcs;
     double sequential_overhead = total_lcs_time - parallel_time;
@@ -106,7 +1450,7 @@ int LCS_Parallel(mtype *restrict scoreArray, size_t sizeA, size_t sizeB, const c
     printf("Parallel time: %.6fs\n", parallel_time);
     printf("Sequential time: %.6fs\n", sequential_overhead);
 
-    return SCORE(sizeB, sizeA);
+    return DSCORE(store, sizeB, sizeA);
 }
 
 void printMatrix(const char *seqA, const char *seqB, mtype *scoreArray, size_t sizeA,
@@ -141,25 +1485,363 @@ void printMatrix(const char *seqA, const char *seqB, mtype *scoreArray, size_t s
     printf("========================================\n");
 }
 
+// One pair of the batch modes; order is its line in the output
+typedef struct {
+    size_t query;
+    size_t target;
+    size_t targetSize;
+    size_t order;
+} lcsPair;
+
+int compareTargetSize(const void *a, const void *b) {
+    const lcsPair *pa = a, *pb = b;
+    return (pa->targetSize > pb->targetSize) - (pa->targetSize < pb->targetSize);
+}
+
+// Scores every query record against every target record, or with allPairs
+// every pair of distinct records of queries, and writes a TSV of scores to
+// out. The targets of a query are sorted by length and cut into groups of
+// BATCH_LANES so lanes of one vector finish close together; the groups are
+// spread over the threads with a dynamic schedule
+void LCS_Batch(const seq_records *queries, const seq_records *targets, int allPairs, FILE *out) {
+    double start_lcs = omp_get_wtime();
+    if (allPairs) targets = queries;
+
+    size_t numPairs = allPairs ? queries->count * (queries->count - (queries->count > 0)) / 2
+                               : queries->count * targets->count;
+    lcsPair *pairs = malloc((numPairs + 1) * sizeof(lcsPair));
+    // a batch is a run of at most BATCH_LANES pairs of the same query
+    size_t *batchStart = malloc((numPairs + queries->count + 1) * sizeof(size_t));
+    mtype *scores = malloc((numPairs + 1) * sizeof(mtype));
+    if (!pairs || !batchStart || !scores) {
+        fprintf(stderr, "Error allocating memory for %zu pairs\n", numPairs);
+        exit(EXIT_FAILURE);
+    }
+
+    size_t numBatches = 0, maxQuery = 0, maxTarget = 0;
+    size_t p = 0;
+    for (size_t q = 0; q < queries->count; q++) {
+        size_t first = p;
+        for (size_t t = allPairs ? q + 1 : 0; t < targets->count; t++) {
+            pairs[p] = (lcsPair){q, t, targets->lengths[t], p};
+            p++;
+            if (targets->lengths[t] > maxTarget) maxTarget = targets->lengths[t];
+        }
+        if (p > first && queries->lengths[q] > maxQuery) maxQuery = queries->lengths[q];
+        qsort(pairs + first, p - first, sizeof(lcsPair), compareTargetSize);
+        for (size_t b = first; b < p; b += BATCH_LANES) batchStart[numBatches++] = b;
+    }
+    batchStart[numBatches] = p;
+
+    if ((maxQuery < maxTarget ? maxQuery : maxTarget) > MTYPE_MAX)
+        fprintf(stderr, "Warning: scores above %d overflow the batch lanes\n", MTYPE_MAX);
+
+    double start_parallel = omp_get_wtime();
+#pragma omp parallel
+    {
+        batchVec *row;
+        if (posix_memalign((void **)&row, 64, (maxQuery + 1) * sizeof(batchVec)) != 0) {
+            fprintf(stderr, "Error allocating memory for batch rows\n");
+            exit(EXIT_FAILURE);
+        }
+        const char *laneSeqs[BATCH_LANES];
+        size_t laneSizes[BATCH_LANES];
+        mtype laneScores[BATCH_LANES];
+
+#pragma omp for schedule(dynamic)
+        for (size_t b = 0; b < numBatches; b++) {
+            size_t first = batchStart[b];
+            size_t lanes = batchStart[b + 1] - first;
+            size_t q = pairs[first].query;
+            for (size_t k = 0; k < lanes; k++) {
+                laneSeqs[k] = targets->seqs[pairs[first + k].target];
+                laneSizes[k] = pairs[first + k].targetSize;
+            }
+            batchKernel(queries->seqs[q], queries->lengths[q], laneSeqs, laneSizes, lanes, row,
+                        laneScores);
+            for (size_t k = 0; k < lanes; k++) scores[pairs[first + k].order] = laneScores[k];
+        }
+        free(row);
+    }
+    double parallel_time = omp_get_wtime() - start_parallel;
+
+    // pairs come out in the order they were enumerated, named records by
+    // name and plain lines by line number
+    fprintf(out, "query\ttarget\tscore\n");
+    p = 0;
+    for (size_t q = 0; q < queries->count; q++) {
+        for (size_t t = allPairs ? q + 1 : 0; t < targets->count; t++) {
+            if (queries->names[q])
+                fprintf(out, "%s\t", queries->names[q]);
+            else
+                fprintf(out, "%zu\t", queries->lines[q]);
+            if (targets->names[t])
+                fprintf(out, "%s\t", targets->names[t]);
+            else
+                fprintf(out, "%zu\t", targets->lines[t]);
+            fprintf(out, "%d\n", scores[p++]);
+        }
+    }
+
+    free(pairs);
+    free(batchStart);
+    free(scores);
+
+    // the scores may be on stdout, so timings go to stderr
+    double total_lcs_time = omp_get_wtime() - start_lcs;
+    fprintf(stderr, "Pairs: %zu\n", numPairs);
+    fprintf(stderr, "Total time: %.6fs\n", total_lcs_time);
+    fprintf(stderr, "Parallel time: %.6fs\n", parallel_time);
+    fprintf(stderr, "Sequential time: %.6fs\n", total_lcs_time - parallel_time);
+}
+
+void usage(const char *prog) {
+    fprintf(stderr,
+            "Usage: %s [-m matrix|diagonal|linear|tiled|pipeline|bits] [-k kernel] [-t tile] "
+            "[-o lcs.out] [fileA.in fileB.in]\n"
+            "       %s -m tiled [-t tile] -c checkpoint [-i interval] [fileA.in fileB.in]\n"
+            "       %s -m batch [-k kernel] [-o scores.tsv] [queries.in targets.in]\n"
+            "       %s -m allpairs [-k kernel] [-o scores.tsv] [records.in]\n",
+            prog, prog, prog, prog);
+    fprintf(stderr, "  -N: print the CPU and node of every thread and the nodes of the score "
+                    "pages\n");
+    fprintf(stderr, "  kernel: auto|scalar|sse41|avx2|avx512bw\n");
+    fprintf(stderr, "  tile: HxW, N for NxN or auto, tiled, pipeline and bits engines only\n");
+    fprintf(stderr, "  records: FASTA or one sequence per line, scores go to stdout by default\n");
+    fprintf(stderr,
+            "  checkpoint: snapshot every interval tile antidiagonals (default %d), resumed when "
+            "it\n              matches the input and tile shape\n",
+            CHECKPOINT_INTERVAL);
+    exit(EXIT_FAILURE);
+}
+
 int main(int argc, char **argv) {
-    char *seqA = read_seq("A.in");
-    char *seqB = read_seq("B.in");
-    size_t sizeA = strlen(seqA);
-    size_t sizeB = strlen(seqB);
+    // the full score array is only needed to print it
+#ifdef DEBUGMATRIX
+    lcsMode mode = MODE_MATRIX;
+#else
+    lcsMode mode = MODE_LINEAR;
+#endif
+    // traceback output, the subsequence is only reconstructed when set
+    const char *lcsFile = NULL;
+    // SIMD kernel of the antidiagonal engines, the widest available by default
+    const char *kernelRequest = "auto";
+    // tile shape of the tiled engines, timed on a prefix of the input with -t auto
+    tileShape tile = {0, 0};
+    int autotune = 0;
+    // snapshot file of the tiled engine, set once autotuning is done
+    const char *checkpointFile = NULL;
+    // thread and page placement report
+    int numaReport = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "m:o:k:t:c:i:N")) != -1) {
+        switch (opt) {
+            case 'm':
+                if (strcmp(optarg, "matrix") == 0)
+                    mode = MODE_MATRIX;
+                else if (strcmp(optarg, "diagonal") == 0)
+                    mode = MODE_DIAGONAL;
+                else if (strcmp(optarg, "linear") == 0)
+                    mode = MODE_LINEAR;
+                else if (strcmp(optarg, "tiled") == 0)
+                    mode = MODE_TILED;
+                else if (strcmp(optarg, "pipeline") == 0)
+                    mode = MODE_PIPELINE;
+                else if (strcmp(optarg, "bits") == 0)
+                    mode = MODE_BITS;
+                else if (strcmp(optarg, "batch") == 0)
+                    mode = MODE_BATCH;
+                else if (strcmp(optarg, "allpairs") == 0)
+                    mode = MODE_ALLPAIRS;
+                else
+                    usage(argv[0]);
+                break;
+            case 'o':
+                lcsFile = optarg;
+                break;
+            case 'k':
+                if (!isDiagKernelName(optarg)) usage(argv[0]);
+                kernelRequest = optarg;
+                break;
+            case 't':
+                if (strcmp(optarg, "auto") == 0)
+                    autotune = 1;
+                else if (!parseTileShape(optarg, &tile))
+                    usage(argv[0]);
+                break;
+            case 'c':
+                checkpointFile = optarg;
+                break;
+            case 'i':
+                if (atoi(optarg) <= 0) usage(argv[0]);
+                checkpoint.interval = atoi(optarg);
+                break;
+            case 'N':
+                numaReport = 1;
+                break;
+            default:
+                usage(argv[0]);
+        }
+    }
+    int numFiles = argc - optind;
+    if (numFiles != 0 && numFiles != (mode == MODE_ALLPAIRS ? 1 : 2)) usage(argv[0]);
+    if (checkpointFile && (mode != MODE_TILED || lcsFile)) usage(argv[0]);
 
-    mtype *scoreArray = allocateScoreArray(sizeA, sizeB);
-    initScoreArray(scoreArray, sizeA, sizeB);
+    const char *kernelName = selectDiagKernel(kernelRequest);
+    if (!kernelName) {
+        fprintf(stderr, "SIMD kernel %s is not supported on this CPU\n", kernelRequest);
+        exit(EXIT_FAILURE);
+    }
+    if (mode == MODE_DIAGONAL || mode == MODE_LINEAR) printf("SIMD kernel: %s\n", kernelName);
+    bindThreads(numaReport);
 
-    mtype score = LCS_Parallel(scoreArray, sizeA, sizeB, seqA, seqB);
+    if (mode == MODE_BATCH || mode == MODE_ALLPAIRS) {
+        // -o names the TSV of scores here
+        FILE *fout = lcsFile ? fopen(lcsFile, "w") : stdout;
+        if (!fout) {
+            fprintf(stderr, "Error writing file %s\n", lcsFile);
+            exit(EXIT_FAILURE);
+        }
+        fprintf(stderr, "SIMD kernel: %s\n", kernelName);
+        seq_records queries = seq_load_records(numFiles > 0 ? argv[optind] : "A.in", 0);
+        if (mode == MODE_ALLPAIRS) {
+            LCS_Batch(&queries, NULL, 1, fout);
+        } else {
+            seq_records targets = seq_load_records(numFiles > 0 ? argv[optind + 1] : "B.in", 0);
+            LCS_Batch(&queries, &targets, 0, fout);
+            seq_free_records(&targets);
+        }
+        seq_free_records(&queries);
+        if (fout != stdout) fclose(fout);
+        return EXIT_SUCCESS;
+    }
+
+    // A.in and B.in in the working directory unless both files are given
+    seq_records fileA = seq_load_records(numFiles == 2 ? argv[optind] : "A.in", SEQ_JOIN_LINES);
+    seq_records fileB =
+        seq_load_records(numFiles == 2 ? argv[optind + 1] : "B.in", SEQ_JOIN_LINES);
+    char *seqA = fileA.seqs[0];
+    char *seqB = fileB.seqs[0];
+    size_t sizeA = fileA.lengths[0];
+    size_t sizeB = fileB.lengths[0];
+
+    // every other engine keeps 16-bit cells
+    size_t sizeMin = sizeA < sizeB ? sizeA : sizeB;
+    if (mode != MODE_BITS && sizeMin > MTYPE_MAX)
+        fprintf(stderr, "Warning: scores above %d overflow this engine, use -m bits\n", MTYPE_MAX);
+
+    if (autotune && checkpointFile) {
+        // a restart keeps the shape the interrupted run was tuned to
+        seq_checkpoint_header header =
+            seq_checkpoint_header_of(seqA, sizeA, sizeA, seqB, sizeB, sizeB, 0, 0);
+        uint32_t height, width;
+        if (seq_checkpoint_tile(checkpointFile, &header, &height, &width)) {
+            tile.height = height;
+            tile.width = width;
+            autotune = 0;
+        }
+    }
+    if (mode == MODE_TILED || mode == MODE_PIPELINE || mode == MODE_BITS) {
+        if (autotune) {
+            double start_tune = omp_get_wtime();
+            if (mode == MODE_BITS)
+                tile = autotuneTile(bitWavefront, 16, sizeA, sizeB, seqA, seqB);
+            else
+                tile = autotuneTile(mode == MODE_TILED ? tiledWavefront : pipelineWavefront, 1,
+                                    sizeA, sizeB, seqA, seqB);
+            printf("Autotune time: %.6fs\n", omp_get_wtime() - start_tune);
+        } else if (tile.height == 0) {
+            tile.height = mode == MODE_BITS ? BIT_TILE_HEIGHT : TILE_SIZE;
+            tile.width = mode == MODE_BITS ? BIT_TILE_WIDTH : TILE_SIZE;
+        }
+        printf("Tile: %zux%zu\n", tile.height, tile.width);
+    }
+    checkpoint.path = checkpointFile;
+
+#ifdef LCS_TRACE
+    // only the engine below is traced, after any autotuning
+    uint64_t traceOrigin = seq_trace_now();
+    traceStart();
+#endif
+
+    int score;
+    if (lcsFile) {
+        // linear-space traceback, the subsequence is written to lcsFile
+        char *lcs = malloc((sizeA < sizeB ? sizeA : sizeB) + 1);
+        if (!lcs) {
+            fprintf(stderr, "Error allocating memory for the LCS\n");
+            exit(EXIT_FAILURE);
+        }
+        score = LCS_Hirschberg(seqA, sizeA, seqB, sizeB, lcs);
+
+        FILE *flcs = fopen(lcsFile, "w");
+        if (!flcs) {
+            fprintf(stderr, "Error writing file %s\n", lcsFile);
+            exit(EXIT_FAILURE);
+        }
+        fprintf(flcs, "%s\n", lcs);
+        fclose(flcs);
+        free(lcs);
+    } else if (mode == MODE_DIAGONAL) {
+        diagStore store = allocateDiagStore(sizeA, sizeB);
+        printf("Pages: %s\n", seq_buffer_pages(&store.memory));
+
+        score = (mtype)LCS_Parallel_Diagonal(store, sizeA, sizeB, seqA, seqB);
+        if (numaReport)
+            reportPlacement("score store", store.cells, (sizeA + 1) * (sizeB + 1) * sizeof(mtype));
 
 #ifdef DEBUGMATRIX
-    printMatrix(seqA, seqB, scoreArray, sizeA, sizeB);
+        // translate back to row-major for printing
+        seq_buffer printMemory = allocateScoreArray(sizeA, sizeB);
+        mtype *scoreArray = printMemory.data;
+        for (size_t a = 0; a <= sizeB; a++)
+            for (size_t b = 0; b <= sizeA; b++) SCORE(a, b) = DSCORE(store, a, b);
+        printMatrix(seqA, seqB, scoreArray, sizeA, sizeB);
+        seq_buffer_free(&printMemory);
 #endif
 
+        freeDiagStore(store);
+    } else if (mode == MODE_LINEAR) {
+        score = LCS_Parallel_Linear(sizeA, sizeB, seqA, seqB);
+    } else if (mode == MODE_TILED) {
+        score = LCS_Parallel_Tiled(sizeA, sizeB, seqA, seqB, tile);
+    } else if (mode == MODE_PIPELINE) {
+        score = LCS_Parallel_Pipeline(sizeA, sizeB, seqA, seqB, tile);
+    } else if (mode == MODE_BITS) {
+        score = LCS_Parallel_Bits(sizeA, sizeB, seqA, seqB, tile);
+    } else {
+        seq_buffer scoreMemory = allocateScoreArray(sizeA, sizeB);
+        mtype *scoreArray = scoreMemory.data;
+        printf("Pages: %s\n", seq_buffer_pages(&scoreMemory));
+        initScoreArray(scoreArray, sizeA, sizeB);
+
+        // A as its match profile, B packed
+        seq_alphabet alphabet = seq_alphabet_of(seqA, sizeA, seqB, sizeB);
+        uint8_t *packedA = seq_pack(&alphabet, seqA, sizeA);
+        uint64_t *profileA = seq_profile(&alphabet, packedA, sizeA);
+        uint8_t *packedB = seq_pack(&alphabet, seqB, sizeB);
+        free(packedA);
+
+        score = (mtype)LCS_Parallel(scoreArray, sizeA, sizeB, profileA, packedB, alphabet.bits);
+        if (numaReport)
+            reportPlacement("score array", scoreArray, (sizeA + 1) * (sizeB + 1) * sizeof(mtype));
+
+        free(profileA);
+        free(packedB);
+
+#ifdef DEBUGMATRIX
+        printMatrix(seqA, seqB, scoreArray, sizeA, sizeB);
+#endif
+
+        seq_buffer_free(&scoreMemory);
+    }
+
     printf("Score: %d\n", score);
+#ifdef LCS_TRACE
+    traceFinish(traceOrigin);
+#endif
 
-    free(scoreArray);
-    free(seqA);
-    free(seqB);
+    seq_free_records(&fileA);
+    seq_free_records(&fileB);
     return EXIT_SUCCESS;
 }
@@ -0,0 +1,120 @@
+// Large DP buffers for the LCS programs, backed by the biggest pages the
+// system hands out. A score matrix is walked by rows or antidiagonals that
+// jump a whole row between neighbouring cells, so with 4 KB pages nearly
+// every step of a large matrix misses the dTLB. Tried in order:
+//
+//   1 GB hugetlb pages   buffers of 1 GB or more, needs pages reserved in
+//                        /sys/kernel/mm/hugepages/hugepages-1048576kB
+//   2 MB hugetlb pages   buffers of 2 MB or more, same for hugepages-2048kB
+//   2 MB THP             a 2 MB aligned mapping marked MADV_HUGEPAGE, backed by
+//                        huge pages as the kernel finds them
+//   4 KB pages           the same mapping when THP is disabled
+//
+// Every buffer is a fresh anonymous mapping: zero-filled and untouched, so the
+// first thread to write a page decides its NUMA node.
+#ifndef SEQ_ALLOC_H
+#define SEQ_ALLOC_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+#define SEQ_ALLOC_HUGE_2MB (21 << MAP_HUGE_SHIFT)
+#define SEQ_ALLOC_HUGE_1GB (30 << MAP_HUGE_SHIFT)
+
+typedef enum {
+    SEQ_PAGES_HUGETLB_1GB,
+    SEQ_PAGES_HUGETLB_2MB,
+    SEQ_PAGES_THP,
+    SEQ_PAGES_SMALL
+} seq_page_kind;
+
+typedef struct {
+    void *data;
+    size_t bytes;   // Requested
+    size_t mapped;  // Length of the mapping, for munmap
+    seq_page_kind pages;
+} seq_buffer;
+
+// Whether transparent huge pages may back a MADV_HUGEPAGE mapping
+static inline int seq_thp_enabled(void) {
+    char mode[64] = "";
+    FILE *f = fopen("/sys/kernel/mm/transparent_hugepage/enabled", "r");
+    if (!f) return 0;
+    if (!fgets(mode, sizeof(mode), f)) mode[0] = '\0';
+    fclose(f);
+    return strstr(mode, "[never]") == NULL && mode[0] != '\0';
+}
+
+// Maps bytes rounded up to page of hugetlb pages, NULL when none are free
+static inline void *seq_map_hugetlb(size_t bytes, size_t page, int flag, size_t *mapped) {
+    if (bytes < page) return NULL;
+    *mapped = (bytes + page - 1) / page * page;
+    void *data = mmap(NULL, *mapped, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | flag, -1, 0);
+    return data == MAP_FAILED ? NULL : data;
+}
+
+// Allocates bytes zeroed on the largest pages available. Exits on failure,
+// like the other allocations of the programs
+static inline seq_buffer seq_buffer_alloc(size_t bytes) {
+    const size_t huge_2mb = (size_t)2 << 20;
+    seq_buffer buffer = {NULL, bytes, 0, SEQ_PAGES_SMALL};
+    if (bytes == 0) bytes = 1;
+
+    buffer.data = seq_map_hugetlb(bytes, (size_t)1 << 30, SEQ_ALLOC_HUGE_1GB, &buffer.mapped);
+    if (buffer.data) {
+        buffer.pages = SEQ_PAGES_HUGETLB_1GB;
+        return buffer;
+    }
+    buffer.data = seq_map_hugetlb(bytes, huge_2mb, SEQ_ALLOC_HUGE_2MB, &buffer.mapped);
+    if (buffer.data) {
+        buffer.pages = SEQ_PAGES_HUGETLB_2MB;
+        return buffer;
+    }
+
+    // an extra huge page of slack lets the buffer start on a 2 MB boundary,
+    // the slack is unmapped again
+    size_t rounded = (bytes + huge_2mb - 1) / huge_2mb * huge_2mb;
+    char *area = mmap(NULL, rounded + huge_2mb, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (area == MAP_FAILED) {
+        fprintf(stderr, "Error allocating %zu bytes of DP storage\n", bytes);
+        exit(EXIT_FAILURE);
+    }
+    char *start = (char *)(((uintptr_t)area + huge_2mb - 1) / huge_2mb * huge_2mb);
+    if (start > area) munmap(area, start - area);
+    if (start + rounded < area + rounded + huge_2mb)
+        munmap(start + rounded, area + rounded + huge_2mb - (start + rounded));
+    buffer.data = start;
+    buffer.mapped = rounded;
+    if (bytes >= huge_2mb && seq_thp_enabled() && madvise(start, rounded, MADV_HUGEPAGE) == 0)
+        buffer.pages = SEQ_PAGES_THP;
+    return buffer;
+}
+
+static inline void seq_buffer_free(seq_buffer *buffer) {
+    if (buffer->data) munmap(buffer->data, buffer->mapped);
+    buffer->data = NULL;
+}
+
+// What backs a buffer, for the programs to report
+static inline const char *seq_buffer_pages(const seq_buffer *buffer) {
+    switch (buffer->pages) {
+        case SEQ_PAGES_HUGETLB_1GB:
+            return "1 GB hugetlb";
+        case SEQ_PAGES_HUGETLB_2MB:
+            return "2 MB hugetlb";
+        case SEQ_PAGES_THP:
+            return "2 MB THP (madvise)";
+        default:
+            return "4 KB";
+    }
+}
+
+#endif
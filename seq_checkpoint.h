@@ -0,0 +1,138 @@
+// Checkpoint files shared by the LCS programs. Every file starts with a
+// header naming the run it belongs to: the sequence lengths and fingerprints,
+// the tile shape and a few engine-specific layout fields. A checkpoint is
+// only resumed by a run whose header matches field by field, anything else
+// starts from scratch.
+//
+// Whole-file snapshots are written to path.tmp, flushed and renamed over
+// path, so a crash while writing leaves the previous snapshot in place.
+#ifndef SEQ_CHECKPOINT_H
+#define SEQ_CHECKPOINT_H
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define SEQ_CHECKPOINT_MAGIC "LCSCKPT1"
+
+typedef struct {
+    char magic[8];
+    uint64_t size_a, size_b;
+    uint64_t hash_a, hash_b;     // seq_fingerprint of both sequences as the engine stores them
+    uint32_t tile_height, tile_width;
+    uint32_t layout[4];          // engine fields that change the meaning of the payload
+    uint64_t diagonal;           // tile antidiagonals completed, 0 when unused
+} seq_checkpoint_header;
+
+// FNV-1a of bytes bytes of data
+static inline uint64_t seq_fingerprint(const void *data, size_t bytes) {
+    const unsigned char *p = (const unsigned char *)data;
+    uint64_t hash = 14695981039346656037ULL ^ (uint64_t)bytes;
+    for (size_t i = 0; i < bytes; i++) hash = (hash ^ p[i]) * 1099511628211ULL;
+    return hash;
+}
+
+// Header of a run, layout fields zero
+static inline seq_checkpoint_header seq_checkpoint_header_of(const void *a, size_t a_bytes,
+                                                             size_t a_length, const void *b,
+                                                             size_t b_bytes, size_t b_length,
+                                                             size_t tile_height,
+                                                             size_t tile_width) {
+    seq_checkpoint_header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SEQ_CHECKPOINT_MAGIC, sizeof(header.magic));
+    header.size_a = a_length;
+    header.size_b = b_length;
+    header.hash_a = seq_fingerprint(a, a_bytes);
+    header.hash_b = seq_fingerprint(b, b_bytes);
+    header.tile_height = tile_height;
+    header.tile_width = tile_width;
+    return header;
+}
+
+// Whether saved was written by the run described by expected, progress aside
+static inline int seq_checkpoint_matches(const seq_checkpoint_header *saved,
+                                         const seq_checkpoint_header *expected) {
+    return memcmp(saved->magic, expected->magic, sizeof(saved->magic)) == 0 &&
+           saved->size_a == expected->size_a && saved->size_b == expected->size_b &&
+           saved->hash_a == expected->hash_a && saved->hash_b == expected->hash_b &&
+           saved->tile_height == expected->tile_height &&
+           saved->tile_width == expected->tile_width &&
+           memcmp(saved->layout, expected->layout, sizeof(saved->layout)) == 0;
+}
+
+// Tile shape of the checkpoint at path when it was written by the run
+// described by expected, whatever its tile shape. A restarted autotuned run
+// takes the shape from there instead of timing again, noisy timings would
+// rarely pick the same one. Returns 0 when there is no such checkpoint
+static inline int seq_checkpoint_tile(const char *path, const seq_checkpoint_header *expected,
+                                      uint32_t *tile_height, uint32_t *tile_width) {
+    seq_checkpoint_header saved, same_tile = *expected;
+    FILE *f = fopen(path, "rb");
+    if (!f) return 0;
+    int found = fread(&saved, sizeof(saved), 1, f) == 1;
+    fclose(f);
+
+    same_tile.tile_height = saved.tile_height;
+    same_tile.tile_width = saved.tile_width;
+    if (!found || saved.tile_height == 0 || saved.tile_width == 0 ||
+        !seq_checkpoint_matches(&saved, &same_tile))
+        return 0;
+    *tile_height = saved.tile_height;
+    *tile_width = saved.tile_width;
+    return 1;
+}
+
+// Writes all of bytes to fd, returns 0 on failure
+static inline int seq_checkpoint_write_all(int fd, const void *data, size_t bytes) {
+    const char *p = (const char *)data;
+    while (bytes > 0) {
+        ssize_t written = write(fd, p, bytes);
+        if (written <= 0) return 0;
+        p += written;
+        bytes -= written;
+    }
+    return 1;
+}
+
+// Replaces the snapshot at path with header and payload, returns 0 on failure
+static inline int seq_checkpoint_replace(const char *path, const seq_checkpoint_header *header,
+                                         const void *payload, size_t bytes) {
+    char tmp_path[4096];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+    int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return 0;
+    int ok = seq_checkpoint_write_all(fd, header, sizeof(*header)) &&
+             seq_checkpoint_write_all(fd, payload, bytes) && fsync(fd) == 0;
+    if (close(fd) != 0) ok = 0;
+    if (ok && rename(tmp_path, path) != 0) ok = 0;
+    if (!ok) unlink(tmp_path);
+    return ok;
+}
+
+// Reads the snapshot at path into payload if it belongs to the run described
+// by expected and holds exactly bytes of payload. Returns the completed
+// diagonals, 0 when there is nothing to resume
+static inline uint64_t seq_checkpoint_load(const char *path, const seq_checkpoint_header *expected,
+                                           void *payload, size_t bytes) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return 0;
+
+    seq_checkpoint_header saved;
+    uint64_t diagonal = 0;
+    if (fread(&saved, sizeof(saved), 1, f) != 1 || !seq_checkpoint_matches(&saved, expected)) {
+        fprintf(stderr, "Warning: %s belongs to another run, starting from scratch\n", path);
+    } else if (fread(payload, 1, bytes, f) != bytes || fgetc(f) != EOF) {
+        fprintf(stderr, "Warning: %s is truncated, starting from scratch\n", path);
+    } else {
+        diagonal = saved.diagonal;
+    }
+    fclose(f);
+    return diagonal;
+}
+
+#endif
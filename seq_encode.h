@@ -0,0 +1,97 @@
+// Alphabet-aware encoding shared by the LCS programs. Every byte in use gets
+// a dense code and sequences are packed at the fewest bits per symbol that
+// hold all codes: 2 for DNA, 4 for alphabets up to 16 symbols such as IUPAC
+// nucleotides, a plain byte otherwise. A match profile has, for every code, a
+// bitmap of the positions of a sequence holding it, so the inner loops test
+// one bit of a word already in a register instead of loading and comparing
+// two characters per cell
+#ifndef SEQ_ENCODE_H
+#define SEQ_ENCODE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    int bits;                   // Bits per symbol of packed sequences, 2, 4 or 8
+    int count;                  // Codes in use
+    unsigned char code[256];    // Code of every byte in use
+    unsigned char symbol[256];  // Byte of every code
+} seq_alphabet;
+
+// Alphabet of the bytes used by either sequence
+static inline seq_alphabet seq_alphabet_of(const char *a, size_t a_length, const char *b,
+                                           size_t b_length) {
+    seq_alphabet alphabet;
+    unsigned char used[256] = {0};
+    memset(&alphabet, 0, sizeof(alphabet));
+    for (size_t i = 0; i < a_length; i++) used[(unsigned char)a[i]] = 1;
+    for (size_t i = 0; i < b_length; i++) used[(unsigned char)b[i]] = 1;
+    for (int c = 0; c < 256; c++) {
+        if (used[c]) {
+            alphabet.code[c] = alphabet.count;
+            alphabet.symbol[alphabet.count++] = c;
+        }
+    }
+    alphabet.bits = alphabet.count <= 4 ? 2 : alphabet.count <= 16 ? 4 : 8;
+    return alphabet;
+}
+
+// Bytes taken by length packed symbols
+static inline size_t seq_packed_size(const seq_alphabet *alphabet, size_t length) {
+    return (length * alphabet->bits + 7) / 8;
+}
+
+// Code of symbol i of a packed sequence
+static inline unsigned seq_packed_code(const uint8_t *packed, int bits, size_t i) {
+    size_t bit = i * bits;
+    return (packed[bit / 8] >> (bit % 8)) & ((1u << bits) - 1);
+}
+
+// Packs seq, the result is malloc'd
+static inline uint8_t *seq_pack(const seq_alphabet *alphabet, const char *seq, size_t length) {
+    uint8_t *packed = calloc(seq_packed_size(alphabet, length) + 1, 1);
+    if (!packed) {
+        fprintf(stderr, "Error allocating memory for a packed sequence\n");
+        exit(EXIT_FAILURE);
+    }
+    for (size_t i = 0; i < length; i++) {
+        size_t bit = i * alphabet->bits;
+        packed[bit / 8] |= alphabet->code[(unsigned char)seq[i]] << (bit % 8);
+    }
+    return packed;
+}
+
+// Words per profile row of a sequence of length symbols, with a spare word so
+// seq_profile_window can always read one word past the last position
+static inline size_t seq_profile_words(size_t length) {
+    return length / 64 + 2;
+}
+
+// Match profile of a packed sequence: row c, seq_profile_words(length) words
+// long, has bit i set where symbol i has code c. The result is malloc'd
+static inline uint64_t *seq_profile(const seq_alphabet *alphabet, const uint8_t *packed,
+                                    size_t length) {
+    size_t words = seq_profile_words(length);
+    uint64_t *profile = calloc((size_t)alphabet->count * words + 1, sizeof(uint64_t));
+    if (!profile) {
+        fprintf(stderr, "Error allocating memory for a match profile\n");
+        exit(EXIT_FAILURE);
+    }
+    for (size_t i = 0; i < length; i++)
+        profile[seq_packed_code(packed, alphabet->bits, i) * words + i / 64] |= (uint64_t)1
+                                                                                 << (i % 64);
+    return profile;
+}
+
+// 64 bits of a profile row starting at position start, for loops that walk a
+// row from an arbitrary column
+static inline uint64_t seq_profile_window(const uint64_t *row, size_t start) {
+    size_t shift = start % 64;
+    uint64_t window = row[start / 64] >> shift;
+    if (shift) window |= row[start / 64 + 1] << (64 - shift);
+    return window;
+}
+
+#endif
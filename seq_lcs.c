@@ -1,6 +1,18 @@
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "seq_alloc.h"
+#include "seq_checkpoint.h"
+#include "seq_encode.h"
+#include "seq_loader.h"
+
+#ifdef LCS_PERF
+#include "seq_perf.h"
+#endif
 
 #ifndef max
 #define max(a, b) (((a) > (b)) ? (a) : (b))
@@ -12,84 +24,441 @@
 
 typedef unsigned short mtype;
 
-/* Read sequence from a file to a char vector.
- Filename is passed as parameter */
-
-char *read_seq(char *fname) {
-    // file pointer
-    FILE *fseq = NULL;
-    // sequence size
-    long size = 0;
-    // sequence pointer
-    char *seq = NULL;
-    // sequence index
-    int i = 0;
-
-    // open file
-    fseq = fopen(fname, "rt");
-    if (fseq == NULL) {
-        printf("Error reading file %s\n", fname);
-        exit(1);
+// largest score an mtype cell holds, the bit-parallel engine has no such limit
+#define MTYPE_MAX 65535
+
+// cells of the out-of-core engine, which is meant for inputs past MTYPE_MAX
+typedef uint32_t wtype;
+
+// engines selectable with -m
+typedef enum {
+    MODE_MATRIX,
+    MODE_LINEAR,
+    MODE_BITPAR,
+    MODE_STREAM,
+    MODE_BANDED,
+    MODE_OUTCORE
+} lcsMode;
+
+// default RAM budget of -m outcore in MB, the stripe recomputed by the traceback must fit
+#define OUTCORE_BUDGET_MB 256
+
+// cell (i, j) of the row-major score matrix, row i of B and column j of A
+#define SCORE(i, j) scoreMatrix[(size_t)(i) * (sizeA + 1) + (j)]
+
+// Allocate the LCS score matrix as one contiguous block on huge pages when
+// the system has them, see seq_alloc.h
+seq_buffer allocateScoreMatrix(int sizeA, int sizeB) {
+    return seq_buffer_alloc((size_t)(sizeA + 1) * (sizeB + 1) * sizeof(mtype));
+}
+
+void initScoreMatrix(mtype *scoreMatrix, int sizeA, int sizeB) {
+    int i, j;
+    // Fill first line of LCS score matrix with zeroes
+    for (j = 0; j < (sizeA + 1); j++) SCORE(0, j) = 0;
+
+    // Do the same for the first collumn
+    for (i = 1; i < (sizeB + 1); i++) SCORE(i, 0) = 0;
+}
+
+/* Fills the score matrix. A is read through its match profile: the row of
+ the current symbol of B is taken 64 columns at a time and every cell tests
+ and shifts out one bit, B is read packed once per row. */
+int LCS(mtype *scoreMatrix, int sizeA, int sizeB, const uint64_t *profileA,
+        const uint8_t *packedB, int bits) {
+    int i, j;
+    size_t words = seq_profile_words(sizeA);
+    for (i = 1; i < sizeB + 1; i++) {
+        const uint64_t *match = profileA + seq_packed_code(packedB, bits, i - 1) * words;
+        for (int first = 1; first < sizeA + 1; first += 64) {
+            uint64_t matches = match[(first - 1) / 64];
+            int last = min(sizeA, first + 63);
+            for (j = first; j <= last; j++, matches >>= 1) {
+                if (matches & 1) {
+                    SCORE(i, j) = SCORE(i - 1, j - 1) + 1;
+                } else {
+                    SCORE(i, j) = max(SCORE(i - 1, j), SCORE(i, j - 1));
+                }
+            }
+        }
     }
+    return SCORE(sizeB, sizeA);
+}
+/* Bit-parallel LCS (Allison-Dix / Hyyro). Bit j of V is set while the
+ current row does not increase between columns j and j+1, so one
+ add/and/or updates 64 cells per word. The score is the number of zero
+ bits left in V. Memory is O(sizeA) bits plus one match mask per symbol.
+ V is the whole state of the last row, so B can also be fed in pieces:
+ lcsStreamAppend extends B by any number of characters and a state saved
+ with lcsStreamSave resumes where it stopped. */
+typedef struct {
+    int sizeA;
+    size_t words;              // 64-bit words per bit vector
+    uint64_t hashA;            // fingerprint of A, a saved state only resumes on the same A
+    uint64_t sizeB;            // characters of B consumed so far
+    unsigned char symbol[256]; // mask slot of every symbol of A, slot 0 stays empty
+    uint64_t *masks;
+    uint64_t *V;
+} lcsStream;
+
+// first bytes of a saved stream state
+#define STREAM_MAGIC "LCSSTRM1"
+
+// Builds the match masks of A and an empty row, as if B were still empty
+void lcsStreamInit(lcsStream *stream, int sizeA, char *seqA) {
+    int j, numSymbols = 0;
+    size_t k;
 
-    // find out sequence size to allocate memory afterwards
-    fseek(fseq, 0L, SEEK_END);
-    size = ftell(fseq);
-    rewind(fseq);
+    memset(stream, 0, sizeof(*stream));
+    stream->sizeA = sizeA;
+    stream->words = ((size_t)sizeA + 63) / 64;
+    stream->hashA = seq_fingerprint(seqA, sizeA);
 
-    // allocate memory (sequence)
-    seq = (char *)calloc(size + 1, sizeof(char));
-    if (seq == NULL) {
-        printf("Erro allocating memory for sequence %s.\n", fname);
+    // give every symbol of A its own mask slot
+    for (j = 0; j < sizeA; j++) {
+        unsigned char c = (unsigned char)seqA[j];
+        if (stream->symbol[c] == 0) stream->symbol[c] = ++numSymbols;
+    }
+
+    stream->masks = (uint64_t *)calloc((size_t)(numSymbols + 1) * stream->words + 1,
+                                       sizeof(uint64_t));
+    stream->V = (uint64_t *)malloc((stream->words + 1) * sizeof(uint64_t));
+    if (stream->masks == NULL || stream->V == NULL) {
+        printf("Error allocating memory for bit vectors.\n");
         exit(1);
     }
 
-    // read sequence from file
-    while (!feof(fseq)) {
-        seq[i] = fgetc(fseq);
-        if ((seq[i] != '\n') && (seq[i] != EOF)) i++;
+    // match mask of symbol s has bit j set where seqA[j] == s
+    for (j = 0; j < sizeA; j++) {
+        uint64_t *M = stream->masks + stream->symbol[(unsigned char)seqA[j]] * stream->words;
+        M[j / 64] |= (uint64_t)1 << (j % 64);
     }
-    // insert string terminator
-    seq[i] = '\0';
 
-    // close file
-    fclose(fseq);
+    for (k = 0; k < stream->words; k++) stream->V[k] = ~(uint64_t)0;
+}
+
+// Appends size characters to B, O(sizeA / 64) word operations each
+void lcsStreamAppend(lcsStream *stream, const char *seqB, size_t size) {
+    size_t i, k;
+    uint64_t *V = stream->V;
 
-    // return sequence pointer
-    return seq;
+    for (i = 0; i < size; i++) {
+        uint64_t *M = stream->masks + stream->symbol[(unsigned char)seqB[i]] * stream->words;
+        uint64_t carry = 0;
+        for (k = 0; k < stream->words; k++) {
+            uint64_t v = V[k];
+            uint64_t u = v & M[k];
+            uint64_t sum;
+            // V' = (V + U) | (V - U); U is a subset of V so V - U never borrows
+            uint64_t c1 = __builtin_add_overflow(v, u, &sum);
+            uint64_t c2 = __builtin_add_overflow(sum, carry, &sum);
+            carry = c1 | c2;
+            V[k] = sum | (v & ~u);
+        }
+    }
+    stream->sizeB += size;
 }
 
-mtype **allocateScoreMatrix(int sizeA, int sizeB) {
-    int i;
-    // Allocate memory for LCS score matrix
-    mtype **scoreMatrix = (mtype **)malloc((sizeB + 1) * sizeof(mtype *));
-    for (i = 0; i < (sizeB + 1); i++) scoreMatrix[i] = (mtype *)malloc((sizeA + 1) * sizeof(mtype));
-    return scoreMatrix;
+// LCS of A and everything appended so far
+int lcsStreamScore(const lcsStream *stream) {
+    size_t k;
+    int sizeA = stream->sizeA;
+
+    // count the zero bits inside the first sizeA positions
+    int score = 0;
+    for (k = 0; k < stream->words; k++) {
+        uint64_t valid = ~(uint64_t)0;
+        if (k == stream->words - 1 && sizeA % 64 != 0) valid = ((uint64_t)1 << (sizeA % 64)) - 1;
+        score += __builtin_popcountll(~stream->V[k] & valid);
+    }
+    return score;
 }
 
-void initScoreMatrix(mtype **scoreMatrix, int sizeA, int sizeB) {
-    int i, j;
-    // Fill first line of LCS score matrix with zeroes
-    for (j = 0; j < (sizeA + 1); j++) scoreMatrix[0][j] = 0;
+/* Writes the row to path. The masks are not saved, they are rebuilt from A
+ on load. The state goes to a temporary file first and is renamed over path,
+ so an interrupted save leaves the previous state intact. Returns 0 on
+ failure. */
+int lcsStreamSave(const lcsStream *stream, const char *path) {
+    char tmpPath[4096];
+    snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", path);
 
-    // Do the same for the first collumn
-    for (i = 1; i < (sizeB + 1); i++) scoreMatrix[i][0] = 0;
+    FILE *f = fopen(tmpPath, "wb");
+    if (f == NULL) return 0;
+    uint64_t sizeA = stream->sizeA;
+    int ok = fwrite(STREAM_MAGIC, 1, 8, f) == 8 && fwrite(&sizeA, sizeof(sizeA), 1, f) == 1 &&
+             fwrite(&stream->hashA, sizeof(stream->hashA), 1, f) == 1 &&
+             fwrite(&stream->sizeB, sizeof(stream->sizeB), 1, f) == 1 &&
+             fwrite(stream->V, sizeof(uint64_t), stream->words, f) == stream->words;
+    if (fclose(f) != 0) ok = 0;
+    if (ok && rename(tmpPath, path) != 0) ok = 0;
+    if (!ok) remove(tmpPath);
+    return ok;
 }
 
-int LCS(mtype **scoreMatrix, int sizeA, int sizeB, char *seqA, char *seqB) {
+/* Resumes a state saved by lcsStreamSave against A. Returns 0 when path
+ cannot be read, is not a stream state or was saved for a different A. */
+int lcsStreamLoad(lcsStream *stream, const char *path, int sizeA, char *seqA) {
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) return 0;
+
+    char magic[8];
+    uint64_t savedSizeA, savedHashA, savedSizeB;
+    int ok = fread(magic, 1, 8, f) == 8 && memcmp(magic, STREAM_MAGIC, 8) == 0 &&
+             fread(&savedSizeA, sizeof(savedSizeA), 1, f) == 1 &&
+             fread(&savedHashA, sizeof(savedHashA), 1, f) == 1 &&
+             fread(&savedSizeB, sizeof(savedSizeB), 1, f) == 1 && savedSizeA == (uint64_t)sizeA &&
+             savedHashA == seq_fingerprint(seqA, sizeA);
+    if (ok) {
+        lcsStreamInit(stream, sizeA, seqA);
+        ok = fread(stream->V, sizeof(uint64_t), stream->words, f) == stream->words;
+        stream->sizeB = savedSizeB;
+        if (!ok) {
+            free(stream->masks);
+            free(stream->V);
+        }
+    }
+    fclose(f);
+    return ok;
+}
+
+void lcsStreamFree(lcsStream *stream) {
+    free(stream->masks);
+    free(stream->V);
+}
+
+// Whole B in one append
+int LCS_BitParallel(int sizeA, int sizeB, char *seqA, char *seqB) {
+    if (sizeA == 0 || sizeB == 0) return 0;
+
+    lcsStream stream;
+    lcsStreamInit(&stream, sizeA, seqA);
+    lcsStreamAppend(&stream, seqB, sizeB);
+    int score = lcsStreamScore(&stream);
+    lcsStreamFree(&stream);
+    return score;
+}
+
+/* Score-only LCS keeping two rolling rows. The shorter sequence runs
+ along the row, so memory is O(min(sizeA, sizeB)) and both rows stay
+ cache resident. */
+int LCS_Linear(int sizeA, int sizeB, char *seqA, char *seqB) {
     int i, j;
+
+    // the recurrence is symmetric, let the shorter sequence be A
+    if (sizeA > sizeB) {
+        char *seqTmp = seqA;
+        int sizeTmp = sizeA;
+        seqA = seqB;
+        sizeA = sizeB;
+        seqB = seqTmp;
+        sizeB = sizeTmp;
+    }
+
+    mtype *prevRow = (mtype *)calloc(sizeA + 1, sizeof(mtype));
+    mtype *currRow = (mtype *)calloc(sizeA + 1, sizeof(mtype));
+    if (prevRow == NULL || currRow == NULL) {
+        printf("Error allocating memory for score rows.\n");
+        exit(1);
+    }
+
     for (i = 1; i < sizeB + 1; i++) {
         for (j = 1; j < sizeA + 1; j++) {
             if (seqA[j - 1] == seqB[i - 1]) {
-                scoreMatrix[i][j] = scoreMatrix[i - 1][j - 1] + 1;
+                currRow[j] = prevRow[j - 1] + 1;
             } else {
-                scoreMatrix[i][j] = max(scoreMatrix[i - 1][j], scoreMatrix[i][j - 1]);
+                currRow[j] = max(prevRow[j], currRow[j - 1]);
             }
         }
+        // the current row becomes the previous one, column 0 stays zero in both
+        mtype *rowTmp = prevRow;
+        prevRow = currRow;
+        currRow = rowTmp;
     }
-    return scoreMatrix[sizeB][sizeA];
+
+    int score = prevRow[sizeA];
+    free(prevRow);
+    free(currRow);
+    return score;
 }
-void printMatrix(char *seqA, char *seqB, mtype **scoreMatrix, int sizeA, int sizeB) {
+
+/* Banded LCS. Only cells whose diagonal offset j - i lies within k of the
+ offsets between 0 and sizeA - sizeB are filled, O(k * sizeA) work with two
+ rolling rows. A path with s matches never strays further than
+ min(sizeA, sizeB) - s from that range, so a result of at least
+ min(sizeA, sizeB) - k is the exact LCS and *exact is set.
+ With minScore > 0 every row also bounds the best score still reachable,
+ a cell can gain at most one per remaining row and column, and the fill
+ stops as soon as that bound drops below minScore. Returns -1 then, with
+ the row reached in *stopRow. The bound covers paths inside the band, so it
+ holds for the true LCS whenever minScore >= min(sizeA, sizeB) - k. */
+int LCS_Banded(int sizeA, int sizeB, char *seqA, char *seqB, int k, int minScore, int *exact,
+               int *stopRow) {
+    int i, j;
+    int lo = min(0, sizeA - sizeB) - k;
+    int hi = max(0, sizeA - sizeB) + k;
+
+    *exact = 0;
+    *stopRow = 0;
+    if (min(sizeA, sizeB) < minScore) return -1;
+
+    mtype *prevRow = (mtype *)calloc(sizeA + 2, sizeof(mtype));
+    mtype *currRow = (mtype *)calloc(sizeA + 2, sizeof(mtype));
+    if (prevRow == NULL || currRow == NULL) {
+        printf("Error allocating memory for score rows.\n");
+        exit(1);
+    }
+
+    for (i = 1; i < sizeB + 1; i++) {
+        int first = max(1, i + lo);
+        int last = min(sizeA, i + hi);
+
+        // cells just outside the band read as zero. A path may also leave this
+        // row from column first - 1 and go down-diagonal from there
+        currRow[first - 1] = 0;
+        int bound = currRow[first - 1] + min(sizeA - first + 1, sizeB - i);
+        for (j = first; j <= last; j++) {
+            if (seqA[j - 1] == seqB[i - 1]) {
+                currRow[j] = prevRow[j - 1] + 1;
+            } else {
+                currRow[j] = max(prevRow[j], currRow[j - 1]);
+            }
+            bound = max(bound, currRow[j] + min(sizeA - j, sizeB - i));
+        }
+        currRow[last + 1] = 0;
+
+        // every path to the corner crosses this row inside the band
+        if (bound < minScore) {
+            *stopRow = i;
+            free(prevRow);
+            free(currRow);
+            return -1;
+        }
+
+        mtype *rowTmp = prevRow;
+        prevRow = currRow;
+        currRow = rowTmp;
+    }
+
+    int score = prevRow[sizeA];
+    *exact = score >= min(sizeA, sizeB) - k;
+    free(prevRow);
+    free(currRow);
+    return score;
+}
+
+// One row of the recurrence: curr from prev and the character b of B
+void lcsRow(const wtype *prev, wtype *curr, int sizeA, const char *seqA, char b) {
+    int j;
+    curr[0] = 0;
+    for (j = 1; j < sizeA + 1; j++) {
+        if (seqA[j - 1] == b) {
+            curr[j] = prev[j - 1] + 1;
+        } else {
+            curr[j] = max(prev[j], curr[j - 1]);
+        }
+    }
+}
+
+/* Traceback with the table out of core. The forward pass keeps two rows in
+ RAM and stores every k-th row in a memory-mapped scratch file, k chosen so
+ k + 1 rows fit the budget. The traceback then goes stripe by stripe from
+ the bottom: the k rows below a stored row are recomputed into RAM and the
+ path is walked back through them, so the table is computed about twice and
+ RAM stays within the budget whatever the input size. The stored rows are
+ page aligned so each can be dropped from the mapping once written or read.
+ Writes the LCS to lcs, at least min(sizeA, sizeB) + 1 bytes, and returns
+ its length. */
+int LCS_OutOfCore(int sizeA, int sizeB, char *seqA, char *seqB, size_t budget, char *lcs) {
+    int i, j;
+    size_t rowBytes = (size_t)(sizeA + 1) * sizeof(wtype);
+    long page = sysconf(_SC_PAGESIZE);
+    size_t stride = (rowBytes + page - 1) / page * page;
+
+    // rows per stripe, at least one
+    size_t fit = budget / rowBytes;
+    if (fit < 2) {
+        fprintf(stderr, "Error: a budget of %zu bytes holds less than two rows of A\n", budget);
+        exit(1);
+    }
+    int k = fit - 1 < (size_t)max(sizeB, 1) ? (int)(fit - 1) : max(sizeB, 1);
+    int stored = sizeB / k + 1;
+
+    // scratch file, unlinked right away so it goes when the process does
+    const char *dir = getenv("TMPDIR") ? getenv("TMPDIR") : "/tmp";
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/lcs_rows_XXXXXX", dir);
+    int fd = mkstemp(path);
+    if (fd < 0 || unlink(path) != 0 || ftruncate(fd, (off_t)stored * stride) != 0) {
+        fprintf(stderr, "Error creating scratch file in %s\n", dir);
+        exit(1);
+    }
+    char *rows = mmap(NULL, (size_t)stored * stride, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    wtype *stripe = (wtype *)malloc((size_t)(k + 1) * rowBytes);
+    if (rows == MAP_FAILED || stripe == NULL) {
+        printf("Error allocating memory for the out-of-core traceback.\n");
+        exit(1);
+    }
+    printf("Stored rows: every %d, %zu MB scratch\n", k, ((size_t)stored * stride) >> 20);
+
+    // forward pass, the stored rows are written front to back once
+    madvise(rows, (size_t)stored * stride, MADV_SEQUENTIAL);
+    wtype *prevRow = stripe, *currRow = stripe + (sizeA + 1);
+    memset(prevRow, 0, rowBytes);
+    memcpy(rows, prevRow, rowBytes);
+    for (i = 1; i < sizeB + 1; i++) {
+        lcsRow(prevRow, currRow, sizeA, seqA, seqB[i - 1]);
+        if (i % k == 0) {
+            char *slot = rows + (size_t)(i / k) * stride;
+            memcpy(slot, currRow, rowBytes);
+            // written back by the kernel, no need to keep it mapped
+            madvise(slot, stride, MADV_DONTNEED);
+        }
+        wtype *rowTmp = prevRow;
+        prevRow = currRow;
+        currRow = rowTmp;
+    }
+    int score = prevRow[sizeA];
+
+    // backward pass, stripes are visited from the last stored row to the first
+    madvise(rows, (size_t)stored * stride, MADV_NORMAL);
+    int length = score;
+    lcs[length] = '\0';
+    i = sizeB;
+    j = sizeA;
+    for (int s = (sizeB - 1) / k; s >= 0 && j > 0 && i > 0; s--) {
+        int top = s * k;
+        char *slot = rows + (size_t)s * stride;
+        if (s > 0) madvise(slot - stride, stride, MADV_WILLNEED);
+
+        // recompute rows top..i, stripe row r is table row top + r
+        memcpy(stripe, slot, rowBytes);
+        madvise(slot, stride, MADV_DONTNEED);
+        for (int r = 1; r <= i - top; r++)
+            lcsRow(stripe + (size_t)(r - 1) * (sizeA + 1), stripe + (size_t)r * (sizeA + 1), sizeA,
+                   seqA, seqB[top + r - 1]);
+
+#define STRIPE(r, c) stripe[(size_t)((r) - top) * (sizeA + 1) + (c)]
+        while (i > top && j > 0) {
+            if (seqA[j - 1] == seqB[i - 1]) {
+                if (length > 0) lcs[--length] = seqA[j - 1];
+                i--;
+                j--;
+            } else if (STRIPE(i - 1, j) >= STRIPE(i, j - 1)) {
+                i--;
+            } else {
+                j--;
+            }
+        }
+#undef STRIPE
+    }
+
+    munmap(rows, (size_t)stored * stride);
+    close(fd);
+    free(stripe);
+    return score;
+}
+
+void printMatrix(char *seqA, char *seqB, mtype *scoreMatrix, int sizeA, int sizeB) {
     int i, j;
 
     // print header
@@ -109,17 +478,28 @@ void printMatrix(char *seqA, char *seqB, mtype **scoreMatrix, int sizeA, int siz
         else
             printf("%c   ", seqB[i - 1]);
         for (j = 0; j < sizeA + 1; j++) {
-            printf("%5d   ", scoreMatrix[i][j]);
+            printf("%5d   ", SCORE(i, j));
         }
         printf("\n");
     }
     printf("========================================\n");
 }
 
-void freeScoreMatrix(mtype **scoreMatrix, int sizeB) {
-    int i;
-    for (i = 0; i < (sizeB + 1); i++) free(scoreMatrix[i]);
-    free(scoreMatrix);
+void freeScoreMatrix(seq_buffer *matrixMemory) {
+    seq_buffer_free(matrixMemory);
+}
+
+void usage(char *prog) {
+    printf("Usage: %s [-m matrix|linear|bitpar|stream|banded|outcore] [-s state] [-k band] "
+           "[-t min] <fileA.in> <fileB.in>\n",
+           prog);
+    printf("  -m stream appends fileB to the B saved in state, or starts a new B without one\n");
+    printf("  -m banded fills diagonals within k of the corner-to-corner band, all without -k,\n"
+           "           and gives up once the score can no longer reach min\n");
+    printf("  -m outcore [-M MB] [-o lcs.out] writes the LCS within a RAM budget (default %d "
+           "MB),\n           keeping rows in a scratch file under $TMPDIR\n",
+           OUTCORE_BUDGET_MB);
+    exit(1);
 }
 
 int main(int argc, char **argv) {
@@ -129,36 +509,178 @@ int main(int argc, char **argv) {
     // sizes of both sequences
     int sizeA, sizeB;
 
-    // read both sequences
-    seqA = read_seq(argv[1]);
-    seqB = read_seq(argv[2]);
+    // LCS engine, the full score matrix is only needed to print it
+#ifdef DEBUGMATRIX
+    lcsMode mode = MODE_MATRIX;
+#else
+    lcsMode mode = MODE_LINEAR;
+#endif
+    // stream mode: saved row, created on the first chunk
+    char *statePath = NULL;
+    // banded mode: band half-width, negative for the whole table, and score threshold
+    int band = -1, minScore = 0;
+    // out-of-core traceback: RAM budget in MB and output of the LCS, stdout without one
+    size_t budgetMB = OUTCORE_BUDGET_MB;
+    char *lcsPath = NULL;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "m:s:k:t:M:o:")) != -1) {
+        switch (opt) {
+            case 'm':
+                if (strcmp(optarg, "matrix") == 0)
+                    mode = MODE_MATRIX;
+                else if (strcmp(optarg, "linear") == 0)
+                    mode = MODE_LINEAR;
+                else if (strcmp(optarg, "bitpar") == 0)
+                    mode = MODE_BITPAR;
+                else if (strcmp(optarg, "stream") == 0)
+                    mode = MODE_STREAM;
+                else if (strcmp(optarg, "banded") == 0)
+                    mode = MODE_BANDED;
+                else if (strcmp(optarg, "outcore") == 0)
+                    mode = MODE_OUTCORE;
+                else
+                    usage(argv[0]);
+                break;
+            case 's':
+                statePath = optarg;
+                break;
+            case 'k':
+                band = atoi(optarg);
+                if (band < 0) usage(argv[0]);
+                break;
+            case 't':
+                minScore = atoi(optarg);
+                break;
+            case 'M':
+                if (atoi(optarg) <= 0) usage(argv[0]);
+                budgetMB = atoi(optarg);
+                break;
+            case 'o':
+                lcsPath = optarg;
+                break;
+            default:
+                usage(argv[0]);
+        }
+    }
+    if (argc - optind < 2 || (mode == MODE_STREAM && statePath == NULL)) usage(argv[0]);
+
+    // map both files, the first record of each is the sequence
+    seq_records fileA = seq_load_records(argv[optind], SEQ_JOIN_LINES);
+    seq_records fileB = seq_load_records(argv[optind + 1], SEQ_JOIN_LINES);
+    seqA = fileA.seqs[0];
+    seqB = fileB.seqs[0];
 
     // find out sizes
-    sizeA = strlen(seqA);
-    sizeB = strlen(seqB);
+    sizeA = fileA.lengths[0];
+    sizeB = fileB.lengths[0];
 
-    // allocate LCS score matrix
-    mtype **scoreMatrix = allocateScoreMatrix(sizeA, sizeB);
+    if (mode != MODE_BITPAR && mode != MODE_STREAM && mode != MODE_OUTCORE &&
+        min(sizeA, sizeB) > MTYPE_MAX)
+        fprintf(stderr, "Warning: scores above %d overflow this engine, use -m bitpar\n",
+                MTYPE_MAX);
+
+    int score;
+    if (mode == MODE_OUTCORE) {
+        char *lcs = (char *)malloc(min(sizeA, sizeB) + 1);
+        if (lcs == NULL) {
+            printf("Error allocating memory for the LCS.\n");
+            exit(1);
+        }
+        score = LCS_OutOfCore(sizeA, sizeB, seqA, seqB, budgetMB << 20, lcs);
 
-    // initialize LCS score matrix
-    initScoreMatrix(scoreMatrix, sizeA, sizeB);
+        FILE *out = lcsPath ? fopen(lcsPath, "w") : stdout;
+        if (out == NULL) {
+            fprintf(stderr, "Error writing file %s\n", lcsPath);
+            exit(1);
+        }
+        fprintf(out, "%s\n", lcs);
+        if (out != stdout) fclose(out);
+        free(lcs);
+    } else if (mode == MODE_BANDED) {
+        int exact, stopRow;
+        if (band < 0) band = max(sizeA, sizeB);
+        score = LCS_Banded(sizeA, sizeB, seqA, seqB, band, minScore, &exact, &stopRow);
+        if (score < 0) {
+            printf("Below threshold: LCS < %d, stopped at row %d of %d\n", minScore, stopRow,
+                   sizeB);
+            seq_free_records(&fileA);
+            seq_free_records(&fileB);
+            return EXIT_SUCCESS;
+        }
+        printf("Exact: %s\n", exact ? "yes" : "no, widen the band");
+    } else if (mode == MODE_STREAM) {
+        // fileB is the next chunk of B, the state holds the row left by the earlier ones
+        lcsStream stream;
+        if (access(statePath, F_OK) != 0) {
+            lcsStreamInit(&stream, sizeA, seqA);
+        } else if (!lcsStreamLoad(&stream, statePath, sizeA, seqA)) {
+            fprintf(stderr, "Error loading %s, not a state saved for this reference\n", statePath);
+            exit(1);
+        }
+        lcsStreamAppend(&stream, seqB, sizeB);
+        score = lcsStreamScore(&stream);
+        if (!lcsStreamSave(&stream, statePath)) {
+            fprintf(stderr, "Error saving %s\n", statePath);
+            exit(1);
+        }
+        printf("Consumed: %llu\n", (unsigned long long)stream.sizeB);
+        lcsStreamFree(&stream);
+    } else if (mode == MODE_BITPAR) {
+        // score-only, the matrix is never allocated
+        score = LCS_BitParallel(sizeA, sizeB, seqA, seqB);
+    } else if (mode == MODE_LINEAR) {
+        // score-only, two rolling rows of the shorter sequence
+        score = LCS_Linear(sizeA, sizeB, seqA, seqB);
+    } else {
+        // allocate LCS score matrix
+        seq_buffer matrixMemory = allocateScoreMatrix(sizeA, sizeB);
+        mtype *scoreMatrix = matrixMemory.data;
+        printf("Pages: %s\n", seq_buffer_pages(&matrixMemory));
 
-    // fill up the rest of the matrix and return final score (element locate at the last line and
-    // collumn)
-    mtype score = LCS(scoreMatrix, sizeA, sizeB, seqA, seqB);
+        // initialize LCS score matrix
+        initScoreMatrix(scoreMatrix, sizeA, sizeB);
 
-    /* if you wish to see the entire score matrix,
-     for debug purposes, define DEBUGMATRIX. */
+        // encode both sequences, A as its match profile and B packed
+        seq_alphabet alphabet = seq_alphabet_of(seqA, sizeA, seqB, sizeB);
+        uint8_t *packedA = seq_pack(&alphabet, seqA, sizeA);
+        uint64_t *profileA = seq_profile(&alphabet, packedA, sizeA);
+        uint8_t *packedB = seq_pack(&alphabet, seqB, sizeB);
+        free(packedA);
+
+        // fill up the rest of the matrix and return final score (element locate at the last line
+        // and collumn)
+#ifdef LCS_PERF
+        seq_perf_counters perf;
+        seq_perf_open(&perf);
+        seq_perf_enable(&perf);
+#endif
+        score = (mtype)LCS(scoreMatrix, sizeA, sizeB, profileA, packedB, alphabet.bits);
+#ifdef LCS_PERF
+        seq_perf_disable(&perf);
+        seq_perf_close(&perf);
+        seq_perf_print(stdout, "Perf LCS", &perf);
+#endif
+
+        free(profileA);
+        free(packedB);
+
+        /* if you wish to see the entire score matrix,
+         for debug purposes, define DEBUGMATRIX. */
 #ifdef DEBUGMATRIX
-    printMatrix(seqA, seqB, scoreMatrix, sizeA, sizeB);
+        printMatrix(seqA, seqB, scoreMatrix, sizeA, sizeB);
 #endif
 
+        // free score matrix
+        freeScoreMatrix(&matrixMemory);
+    }
+
     // print score and time to compute
     /* printf("SEQUENTIAL: %.6fs\n", end_time - start_time); */
     printf("Score: %d\n", score);
 
-    // free score matrix
-    freeScoreMatrix(scoreMatrix, sizeB);
+    seq_free_records(&fileA);
+    seq_free_records(&fileB);
 
     return EXIT_SUCCESS;
 }
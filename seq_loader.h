@@ -0,0 +1,167 @@
+// Sequence loader shared by the LCS programs. Files are memory-mapped
+// copy-on-write and parsed in place: line breaks and headers are squeezed out
+// with memchr/memmove, so only pages that actually hold a line break are ever
+// copied and a file without line breaks is never copied at all.
+//
+// Accepted formats, told apart by the first byte:
+//   '>'   FASTA, a header line names the record, the lines up to the next
+//         header are its sequence
+//   '@'   FASTQ, header, sequence lines, a '+' line and as many quality
+//         characters as the sequence has
+//   else  plain text, either one sequence per line or, with SEQ_JOIN_LINES,
+//         all lines joined into a single sequence
+#ifndef SEQ_LOADER_H
+#define SEQ_LOADER_H
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Plain text: join every line into one record instead of a record per line
+#define SEQ_JOIN_LINES 1
+
+// Records of one file. seqs and names point into the mapping and are NUL
+// terminated; names are NULL for plain text, where lines holds the 1-based
+// line a record starts on
+typedef struct {
+    char *data;
+    size_t mapped;
+    char **seqs;
+    char **names;
+    size_t *lengths;
+    size_t *lines;
+    size_t count;
+} seq_records;
+
+// Exits with a message naming path
+static inline void seq_loader_fail(const char *what, const char *path) {
+    fprintf(stderr, "Error %s %s\n", what, path);
+    exit(EXIT_FAILURE);
+}
+
+// Maps path privately, with at least one writable byte past the end of the
+// file for the last terminator. The whole range is reserved anonymously first
+// and the file mapped over it, so that byte exists even when the file ends on
+// a page boundary
+static inline char *seq_loader_map(const char *path, size_t *size, size_t *mapped) {
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) seq_loader_fail("reading file", path);
+    *size = st.st_size;
+
+    long page = sysconf(_SC_PAGESIZE);
+    *mapped = (*size + 1 + page - 1) / page * page;
+    char *data = mmap(NULL, *mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (data == MAP_FAILED) seq_loader_fail("mapping file", path);
+    if (*size > 0 && mmap(data, *size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0) ==
+                         MAP_FAILED)
+        seq_loader_fail("mapping file", path);
+    close(fd);
+    // parsed front to back once
+    madvise(data, *mapped, MADV_SEQUENTIAL);
+    return data;
+}
+
+// Appends an empty record, growing the arrays when full
+static inline void seq_loader_push(seq_records *records, size_t *capacity, char *name, char *seq,
+                                   size_t line) {
+    if (records->count == *capacity) {
+        *capacity = *capacity ? *capacity * 2 : 16;
+        records->seqs = realloc(records->seqs, *capacity * sizeof(char *));
+        records->names = realloc(records->names, *capacity * sizeof(char *));
+        records->lengths = realloc(records->lengths, *capacity * sizeof(size_t));
+        records->lines = realloc(records->lines, *capacity * sizeof(size_t));
+        if (!records->seqs || !records->names || !records->lengths || !records->lines)
+            seq_loader_fail("allocating records of", "input");
+    }
+    records->names[records->count] = name;
+    records->seqs[records->count] = seq;
+    records->lengths[records->count] = 0;
+    records->lines[records->count] = line;
+    records->count++;
+}
+
+// Loads every record of path. Output is written at or before the input it
+// comes from, a header always leaves room for the record's own terminators
+static inline seq_records seq_load_records(const char *path, int flags) {
+    seq_records records = {0};
+    size_t capacity = 0, size;
+    records.data = seq_loader_map(path, &size, &records.mapped);
+
+    char *in = records.data;
+    char *end = records.data + size;
+    char *out = records.data;
+    char format = size > 0 ? records.data[0] : 0;
+    int headers = format == '>' || format == '@';
+    size_t line = 1;
+
+    if (!headers && (flags & SEQ_JOIN_LINES)) seq_loader_push(&records, &capacity, NULL, out, 1);
+
+    while (in < end) {
+        char *eol = memchr(in, '\n', end - in);
+        if (!eol) eol = end;
+        size_t length = eol - in;
+        if (length > 0 && in[length - 1] == '\r') length--;
+
+        if (headers && in[0] == format) {
+            // close the previous record, then keep the name up to the first blank
+            if (records.count > 0) *out++ = '\0';
+            size_t name_length = strcspn(in + 1, " \t\r\n");
+            if (name_length > length - 1) name_length = length - 1;
+            memmove(out, in + 1, name_length);
+            char *name = out;
+            out += name_length;
+            *out++ = '\0';
+            seq_loader_push(&records, &capacity, name, out, line);
+        } else if (headers && format == '@' && in[0] == '+' && records.count > 0) {
+            // FASTQ qualities: skip lines until they cover the whole sequence
+            size_t quality = 0, want = records.lengths[records.count - 1];
+            while (quality < want && eol < end) {
+                in = eol + 1;
+                line++;
+                eol = memchr(in, '\n', end - in);
+                if (!eol) eol = end;
+                size_t quality_length = eol - in;
+                if (quality_length > 0 && in[quality_length - 1] == '\r') quality_length--;
+                quality += quality_length;
+            }
+        } else if (headers) {
+            if (records.count > 0) {
+                memmove(out, in, length);
+                out += length;
+                records.lengths[records.count - 1] += length;
+            }
+        } else if (flags & SEQ_JOIN_LINES) {
+            memmove(out, in, length);
+            out += length;
+            records.lengths[0] += length;
+        } else if (length > 0) {
+            seq_loader_push(&records, &capacity, NULL, out, line);
+            memmove(out, in, length);
+            out += length;
+            *out++ = '\0';
+            records.lengths[records.count - 1] = length;
+        }
+        in = eol + 1;
+        line++;
+    }
+    // the last record of a headed or joined file is still open
+    if (headers || (flags & SEQ_JOIN_LINES)) *out = '\0';
+    return records;
+}
+
+// Unmaps the file and releases the record arrays
+static inline void seq_free_records(seq_records *records) {
+    munmap(records->data, records->mapped);
+    free(records->seqs);
+    free(records->names);
+    free(records->lengths);
+    free(records->lines);
+    memset(records, 0, sizeof(*records));
+}
+
+#endif
@@ -0,0 +1,123 @@
+// Hardware performance counters for the DP kernels, read through
+// perf_event_open. The programs only call into this header when built with
+// -DLCS_PERF, so a normal build carries no instrumentation at all.
+//
+// Counters count user-space events of the calling thread between
+// seq_perf_open and seq_perf_close while enabled. Every event is opened on
+// its own: one the CPU or the kernel refuses (perf_event_paranoid, a VM
+// without a PMU) is reported as n/a and the others still count. Events the
+// kernel had to multiplex are scaled by the time they actually ran.
+#ifndef SEQ_PERF_H
+#define SEQ_PERF_H
+
+#include <errno.h>
+#include <linux/perf_event.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#define SEQ_PERF_EVENTS 6
+
+static const char *const seq_perf_names[SEQ_PERF_EVENTS] = {
+    "cycles", "instructions", "L1D-misses", "LLC-misses", "branch-misses", "dTLB-misses"};
+
+typedef struct {
+    int fd[SEQ_PERF_EVENTS];          // -1 for events that could not be opened, kept after close
+    uint64_t value[SEQ_PERF_EVENTS];  // Scaled counts, filled by seq_perf_close
+    int opened;                       // Events counting
+    int error;                        // errno of the first event refused
+} seq_perf_counters;
+
+// Type and config of every event, in seq_perf_names order
+static inline void seq_perf_event(int k, struct perf_event_attr *attr) {
+    const uint64_t read_miss = ((uint64_t)PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                               ((uint64_t)PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    const uint64_t configs[SEQ_PERF_EVENTS] = {PERF_COUNT_HW_CPU_CYCLES,
+                                               PERF_COUNT_HW_INSTRUCTIONS,
+                                               PERF_COUNT_HW_CACHE_L1D | read_miss,
+                                               PERF_COUNT_HW_CACHE_MISSES,
+                                               PERF_COUNT_HW_BRANCH_MISSES,
+                                               PERF_COUNT_HW_CACHE_DTLB | read_miss};
+    attr->type = (k == 2 || k == 5) ? PERF_TYPE_HW_CACHE : PERF_TYPE_HARDWARE;
+    attr->config = configs[k];
+}
+
+// Opens the counters of the calling thread, disabled
+static inline void seq_perf_open(seq_perf_counters *counters) {
+    memset(counters, 0, sizeof(*counters));
+    for (int k = 0; k < SEQ_PERF_EVENTS; k++) {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        seq_perf_event(k, &attr);
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        counters->fd[k] = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+        if (counters->fd[k] >= 0) {
+            counters->opened++;
+        } else if (!counters->error) {
+            counters->error = errno;
+        }
+    }
+}
+
+static inline void seq_perf_enable(seq_perf_counters *counters) {
+    for (int k = 0; k < SEQ_PERF_EVENTS; k++)
+        if (counters->fd[k] >= 0) ioctl(counters->fd[k], PERF_EVENT_IOC_ENABLE, 0);
+}
+
+static inline void seq_perf_disable(seq_perf_counters *counters) {
+    for (int k = 0; k < SEQ_PERF_EVENTS; k++)
+        if (counters->fd[k] >= 0) ioctl(counters->fd[k], PERF_EVENT_IOC_DISABLE, 0);
+}
+
+// Reads the final counts and closes the counters
+static inline void seq_perf_close(seq_perf_counters *counters) {
+    for (int k = 0; k < SEQ_PERF_EVENTS; k++) {
+        if (counters->fd[k] < 0) continue;
+        // value, time enabled, time running
+        uint64_t data[3];
+        if (read(counters->fd[k], data, sizeof(data)) == sizeof(data) && data[2] > 0)
+            counters->value[k] = (uint64_t)((double)data[0] * data[1] / data[2]);
+        close(counters->fd[k]);
+    }
+}
+
+// Adds the counts of one thread or rank to a zeroed total, an event missing
+// anywhere is missing from the total
+static inline void seq_perf_add(seq_perf_counters *total, const seq_perf_counters *counters) {
+    total->opened = 0;
+    for (int k = 0; k < SEQ_PERF_EVENTS; k++) {
+        total->value[k] += counters->value[k];
+        if (counters->fd[k] < 0) total->fd[k] = -1;
+        if (total->fd[k] >= 0) total->opened++;
+    }
+    if (!total->error) total->error = counters->error;
+}
+
+// One line of counts after label, with IPC when both cycles and instructions counted
+static inline void seq_perf_print(FILE *out, const char *label,
+                                  const seq_perf_counters *counters) {
+    if (counters->opened == 0) {
+        fprintf(out, "%s: perf counters unavailable (%s)\n", label, strerror(counters->error));
+        return;
+    }
+    fprintf(out, "%s:", label);
+    for (int k = 0; k < SEQ_PERF_EVENTS; k++) {
+        if (counters->fd[k] >= 0)
+            fprintf(out, " %s %llu", seq_perf_names[k], (unsigned long long)counters->value[k]);
+        else
+            fprintf(out, " %s n/a", seq_perf_names[k]);
+    }
+    if (counters->fd[0] >= 0 && counters->fd[1] >= 0 && counters->value[0] > 0)
+        fprintf(out, " IPC %.2f", (double)counters->value[1] / counters->value[0]);
+    fprintf(out, "\n");
+}
+
+#endif
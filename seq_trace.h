@@ -0,0 +1,141 @@
+// Timeline tracing for the LCS programs, written as a Chrome trace that
+// chrome://tracing and ui.perfetto.dev open directly. The programs only call
+// into this header when built with -DLCS_TRACE.
+//
+// Every thread records into a buffer of its own, so recording takes no lock
+// and no atomic: a pair of clock reads and a store, the buffer doubling now
+// and then. Events are spans of one of a few kinds, tagged with the
+// antidiagonal they belong to. Buffers are only read once the threads that
+// own them are done, and written out in one go. Times are CLOCK_MONOTONIC
+// nanoseconds; the writer takes an offset for each buffer so processes whose
+// clocks differ can share one timeline.
+#ifndef SEQ_TRACE_H
+#define SEQ_TRACE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define SEQ_TRACE_INITIAL_EVENTS 4096
+
+// Trace file, LCS_TRACE_FILE overrides it
+#define SEQ_TRACE_DEFAULT_FILE "lcs_trace.json"
+
+typedef enum {
+    SEQ_TRACE_COMPUTE,
+    SEQ_TRACE_SEND,
+    SEQ_TRACE_RECV,
+    SEQ_TRACE_WAIT,
+    SEQ_TRACE_CHECKPOINT,
+    SEQ_TRACE_KINDS
+} seq_trace_kind;
+
+static const char *const seq_trace_names[SEQ_TRACE_KINDS] = {"compute", "send", "recv", "wait",
+                                                             "checkpoint"};
+
+// Plain data, so buffers of other ranks can be shipped as bytes
+typedef struct {
+    uint64_t start, end;  // Nanoseconds on the clock of the recording process
+    int32_t kind;         // seq_trace_kind
+    int32_t diagonal;     // Antidiagonal of the work, -1 when none
+} seq_trace_event;
+
+typedef struct {
+    seq_trace_event *events;
+    size_t count;
+    size_t capacity;
+} seq_trace_buffer;
+
+static inline uint64_t seq_trace_now(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+static inline const char *seq_trace_path(void) {
+    const char *path = getenv("LCS_TRACE_FILE");
+    return path && *path ? path : SEQ_TRACE_DEFAULT_FILE;
+}
+
+// Records a span that started at start and ends now
+static inline void seq_trace_record(seq_trace_buffer *buffer, seq_trace_kind kind,
+                                    uint64_t start, int diagonal) {
+    uint64_t end = seq_trace_now();
+    if (buffer->count == buffer->capacity) {
+        size_t capacity = buffer->capacity ? 2 * buffer->capacity : SEQ_TRACE_INITIAL_EVENTS;
+        seq_trace_event *events = realloc(buffer->events, capacity * sizeof(seq_trace_event));
+        if (!events) return;  // out of memory: the trace loses events, the run goes on
+        buffer->events = events;
+        buffer->capacity = capacity;
+    }
+    seq_trace_event *event = &buffer->events[buffer->count++];
+    event->start = start;
+    event->end = end;
+    event->kind = kind;
+    event->diagonal = diagonal;
+}
+
+static inline void seq_trace_free(seq_trace_buffer *buffer) {
+    free(buffer->events);
+    buffer->events = NULL;
+    buffer->count = buffer->capacity = 0;
+}
+
+typedef struct {
+    FILE *out;
+    const char *path;
+    const char *separator;  // Written before the next entry
+} seq_trace_file;
+
+// Opens a trace file, returns 0 with a warning when it cannot be created
+static inline int seq_trace_begin_file(seq_trace_file *file, const char *path) {
+    file->path = path;
+    file->separator = "\n";
+    file->out = fopen(path, "w");
+    if (!file->out) {
+        fprintf(stderr, "Warning: could not write trace %s\n", path);
+        return 0;
+    }
+    fprintf(file->out, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+    return 1;
+}
+
+// Names the row of process pid, thread tid in the viewer
+static inline void seq_trace_write_names(seq_trace_file *file, int pid, const char *process,
+                                         int tid, const char *thread) {
+    fprintf(file->out,
+            "%s{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"%s\"}}",
+            file->separator, pid, process);
+    file->separator = ",\n";
+    fprintf(file->out,
+            ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,"
+            "\"args\":{\"name\":\"%s\"}}",
+            pid, tid, thread);
+}
+
+// Writes the events of one buffer on the row pid, tid. offset is added to
+// every time to bring it onto the common clock, origin is the instant shown
+// as zero
+static inline void seq_trace_write_events(seq_trace_file *file, int pid, int tid,
+                                          const seq_trace_event *events, size_t count,
+                                          int64_t offset, uint64_t origin) {
+    for (size_t i = 0; i < count; i++) {
+        const seq_trace_event *event = &events[i];
+        double start = ((int64_t)(event->start - origin) + offset) / 1000.0;
+        double duration = (event->end - event->start) / 1000.0;
+        fprintf(file->out,
+                "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,\"ts\":%.3f,"
+                "\"dur\":%.3f,\"args\":{\"diagonal\":%d}}",
+                file->separator, seq_trace_names[event->kind], pid, tid, start, duration,
+                event->diagonal);
+        file->separator = ",\n";
+    }
+}
+
+static inline void seq_trace_end_file(seq_trace_file *file) {
+    fprintf(file->out, "\n]}\n");
+    if (fclose(file->out) != 0) fprintf(stderr, "Warning: could not write trace %s\n", file->path);
+}
+
+#endif